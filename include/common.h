@@ -5,14 +5,15 @@
 #ifndef PROJECT_BASE_COMMON_H
 #define PROJECT_BASE_COMMON_H
 #include <string>
-#include <fstream>
-#include <sstream>
+#include <rg/VirtualFileSystem.h>
 
-std::string readFileContents(std::string path) {
-    std::ifstream in(path);
-    std::stringstream buffer;
-    buffer << in.rdbuf();
-    return buffer.str();
+// whole file, from a mounted asset pack if it has it; empty if it can't be read
+inline std::string readFileContents(std::string path) {
+    rg::FileView file = rg::VirtualFileSystem::Instance().Read(path);
+    if (!file) {
+        return std::string();
+    }
+    return std::string(reinterpret_cast<const char*>(file.data), file.size);
 }
 
 
@@ -7,6 +7,8 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <learnopengl/shader.h>
+#include <rg/GLResource.h>
+#include <rg/UploadScheduler.h>
 
 #include <string>
 #include <vector>
@@ -27,12 +29,96 @@ struct Vertex {
 
 
 
+enum class TextureType : unsigned char {
+    Diffuse,
+    Specular,
+    Normal,
+    Height
+};
+
+// sampler naming convention used by the shaders: <prefix>texture_diffuseN, <prefix>texture_specularN, ...
+inline const char* textureTypeName(TextureType type)
+{
+    switch (type) {
+        case TextureType::Diffuse:  return "texture_diffuse";
+        case TextureType::Specular: return "texture_specular";
+        case TextureType::Normal:   return "texture_normal";
+        case TextureType::Height:   return "texture_height";
+    }
+    return "";
+}
+
+// the plain name some shaders use instead, for the first map of each type: <prefix>diffuse, <prefix>specular, ...
+inline const char* textureTypeShortName(TextureType type)
+{
+    return textureTypeName(type) + sizeof("texture_") - 1;
+}
+
+// Which material maps a program samples and whether it reads tangents, found by reflecting the linked
+// program. The model loader skips decoding and uploading maps nobody samples and only asks ASSIMP for
+// tangent space when some program needs it.
+struct TextureUsage {
+    bool types[4] = {true, true, true, true};
+    bool tangents = true;
+
+    bool Uses(TextureType type) const
+    {
+        return types[static_cast<int>(type)];
+    }
+
+    // everything, for when the program isn't known up front
+    static TextureUsage All()
+    {
+        return TextureUsage();
+    }
+
+    // samplers are matched by name after the prefix: texture_diffuseN or diffuse, and so on for the
+    // other types; tangents are needed when attribute 3 (tangent) or 4 (bitangent) is read
+    static TextureUsage FromShader(const Shader &shader, const std::string &prefix)
+    {
+        TextureUsage usage;
+        for (bool& used : usage.types)
+            used = false;
+        for (std::string name : shader.ActiveSamplers())
+        {
+            if (name.compare(0, prefix.size(), prefix) != 0)
+                continue;
+            name.erase(0, prefix.size());
+            name.erase(name.find_last_not_of("0123456789[]") + 1);
+            for (int type = 0; type < 4; type++)
+                if (name == textureTypeName(static_cast<TextureType>(type)) ||
+                    name == textureTypeShortName(static_cast<TextureType>(type)))
+                    usage.types[type] = true;
+        }
+        usage.tangents = shader.UsesAttribute(3) || shader.UsesAttribute(4);
+        return usage;
+    }
+
+    // union of two programs' needs, for models drawn with both
+    TextureUsage operator|(const TextureUsage &other) const
+    {
+        TextureUsage usage;
+        for (int type = 0; type < 4; type++)
+            usage.types[type] = types[type] || other.types[type];
+        usage.tangents = tangents || other.tangents;
+        return usage;
+    }
+};
+
 struct Texture {
     unsigned int id;
-    string type;
+    TextureType type;
     string path;
 };
 
+// one texture of a mesh with everything Draw needs already looked up
+struct MaterialBinding {
+    TextureType type;
+    GLint location;       // sampler uniform location
+    GLint unit;           // texture unit the sampler is pointed at
+    unsigned int texture; // GL texture name
+};
+
 class Mesh {
 public:
     // mesh Data
@@ -40,70 +126,117 @@ public:
     vector<unsigned int> indices;
     vector<Texture>      textures;
 
-    unsigned int VAO;
-    std::string glslIdentifierPrefix;
-    // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    rg::GLVertexArray VAO;
+    // constructor, takes ownership of the vertex data instead of copying it. With an upload scheduler the
+    // vertices and indices are handed on to it and stream in over the next frames; the mesh is then
+    // drawable once everything queued before a following uploads->Then has been issued.
+    Mesh(vector<Vertex>&& vertices, vector<unsigned int>&& indices, vector<Texture>&& textures,
+         rg::UploadScheduler* uploads = nullptr)
+        : vertices(std::move(vertices))
+        , indices(std::move(indices))
+        , textures(std::move(textures))
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
-
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        setupMesh(uploads);
     }
 
+    // a mesh owns its GL buffers, so it can be moved but not copied
+    Mesh(Mesh&&) = default;
+    Mesh& operator=(Mesh&&) = default;
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+
     // render the mesh
     void Draw(Shader &shader)
     {
         // bind appropriate textures
-        unsigned int diffuseNr  = 1;
-        unsigned int specularNr = 1;
-        unsigned int normalNr   = 1;
-        unsigned int heightNr   = 1;
-        for(unsigned int i = 0; i < textures.size(); i++)
+        for (const MaterialBinding& binding : Material(shader))
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-            // retrieve texture number (the N in diffuse_textureN)
-            string number;
-            string name = textures[i].type;
-            if(name == "texture_diffuse")
-                number = std::to_string(diffuseNr++);
-            else if(name == "texture_specular")
-                number = std::to_string(specularNr++); // transfer unsigned int to stream
-            else if(name == "texture_normal")
-                number = std::to_string(normalNr++); // transfer unsigned int to stream
-            else if(name == "texture_height")
-                number = std::to_string(heightNr++); // transfer unsigned int to stream
-
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (glslIdentifierPrefix + name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            glUniform1i(binding.location, binding.unit);
+            glActiveTexture(GL_TEXTURE0 + binding.unit);
+            glBindTexture(GL_TEXTURE_2D, binding.texture);
         }
 
+        DrawGeometry();
+
+        // always good practice to set everything back to defaults once configured.
+        glActiveTexture(GL_TEXTURE0);
+    }
 
+    // material record for the given program; sampler locations are resolved once per program, not on every draw
+    const vector<MaterialBinding>& Material(const Shader &shader)
+    {
+        if (materialProgram != shader.ID)
+            resolveMaterial(shader);
+        return material;
+    }
 
-        // draw mesh
+    // issues the indexed draw without touching texture state
+    void DrawGeometry() const
+    {
         glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+        glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
         glBindVertexArray(0);
+    }
 
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
+    // frees the CPU copy of vertices and indices; the GPU buffers keep everything Draw needs
+    void ReleaseGeometry()
+    {
+        vector<Vertex>().swap(vertices);
+        vector<unsigned int>().swap(indices);
+    }
+
+    void SetShaderTextureNamePrefix(const std::string& prefix)
+    {
+        glslIdentifierPrefix = prefix;
+        // sampler names changed, look the locations up again on next draw
+        materialProgram = 0;
     }
 
 private:
     // render data
-    unsigned int VBO, EBO;
+    rg::GLBuffer VBO, EBO;
+    GLsizei indexCount = 0;
+    std::string glslIdentifierPrefix;
+    // material record, valid for materialProgram
+    vector<MaterialBinding> material;
+    unsigned int materialProgram = 0;
+
+    // builds the sampler names (<prefix>texture_diffuse1, ...) and looks up their locations in the given program.
+    // Textures the program doesn't sample get no binding at all, the rest are packed into units 0, 1, ...
+    void resolveMaterial(const Shader &shader)
+    {
+        unsigned int counters[4] = {1, 1, 1, 1};
+        material.clear();
+        material.reserve(textures.size());
+        for (unsigned int i = 0; i < textures.size(); i++)
+        {
+            TextureType type = textures[i].type;
+            unsigned int number = counters[static_cast<int>(type)]++;
+            std::string name = glslIdentifierPrefix + textureTypeName(type) + std::to_string(number);
+            GLint location = glGetUniformLocation(shader.ID, name.c_str());
+            if (location == -1 && number == 1)
+                location = glGetUniformLocation(shader.ID, (glslIdentifierPrefix + textureTypeShortName(type)).c_str());
+            if (location == -1)
+                continue;
+            MaterialBinding binding;
+            binding.type = type;
+            binding.location = location;
+            binding.unit = static_cast<GLint>(material.size());
+            binding.texture = textures[i].id;
+            material.push_back(binding);
+        }
+        materialProgram = shader.ID;
+    }
 
     // initializes all the buffer objects/arrays
-    void setupMesh()
+    void setupMesh(rg::UploadScheduler* uploads)
     {
         // create buffers/arrays
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
+        VAO = rg::GLVertexArray::create();
+        VBO = rg::GLBuffer::create();
+        EBO = rg::GLBuffer::create();
+        indexCount = static_cast<GLsizei>(indices.size());
 
         glBindVertexArray(VAO);
         // load data into vertex buffers
@@ -111,10 +244,16 @@ private:
         // A great thing about structs is that their memory layout is sequential for all its items.
         // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
         // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), uploads ? nullptr : vertices.data(), GL_STATIC_DRAW);
 
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), uploads ? nullptr : indices.data(), GL_STATIC_DRAW);
+
+        if (uploads)
+        {
+            uploads->UploadBuffer(VBO, std::move(vertices));
+            uploads->UploadBuffer(EBO, std::move(indices));
+        }
 
         // set the vertex attribute pointers
         // vertex Positions
@@ -12,6 +12,14 @@
 
 #include <learnopengl/mesh.h>
 #include <learnopengl/shader.h>
+#include <rg/GLResource.h>
+#include <rg/ThreadPool.h>
+#include <rg/Image.h>
+#include <rg/UploadScheduler.h>
+#include <rg/TextureCache.h>
+#include <rg/TextureResidency.h>
+#include <rg/AssetIOSystem.h>
+#include <rg/BakedModel.h>
 
 #include <string>
 #include <fstream>
@@ -19,25 +27,135 @@
 #include <iostream>
 #include <map>
 #include <vector>
+#include <algorithm>
+#include <limits>
+#include <cstring>
 using namespace std;
 
 unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
+unsigned int TextureFromImage(const rg::Image &image, bool gamma = false);
+unsigned int TextureFromImage(std::shared_ptr<const rg::Image> image, rg::UploadScheduler &uploads, bool gamma = false);
 
+// texture a mesh refers to, not loaded yet
+struct TextureRef {
+    TextureType type;
+    string path;
 
+    // diffuse maps hold colors and are sampled from sRGB storage, the other maps hold data
+    bool IsColor() const
+    {
+        return type == TextureType::Diffuse;
+    }
+
+    rg::TextureVariant Variant() const
+    {
+        return IsColor() ? rg::TextureVariant::MaterialColor : rg::TextureVariant::Material;
+    }
+};
+
+// CPU side of a mesh, produced without touching OpenGL
+struct MeshData {
+    vector<Vertex>       vertices;
+    vector<unsigned int> indices;
+    vector<TextureRef>   textures;
+};
+
+// everything read from a model file; uploading it is left to the thread that owns the GL context
+struct ModelData {
+    string directory;
+    vector<MeshData> meshes;
+    map<pair<string, rg::TextureVariant>, rg::TextureSource> textures; // looked up in the texture cache, keyed by the path the material uses
+};
 
 class Model
 {
 public:
     // model data
-    vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
     vector<Mesh>    meshes;
+    vector<rg::CachedTexture> textureObjects; // references to the cached textures the meshes use
     string directory;
+    glm::vec3 boundsCenter = glm::vec3(0.0f); // bounding sphere in model space
+    float boundsRadius = 0.0f;
     bool gammaCorrection;
 
     // constructor, expects a filepath to a 3D model.
     Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
     {
-        loadModel(path);
+        upload(LoadData(path));
+    }
+
+    // constructor for data loaded with LoadData, possibly on another thread. Must run on the GL thread.
+    // With an upload scheduler buffers and textures stream in over the next frames instead of being
+    // uploaded right here; the model is complete once a following uploads->Then callback runs. With a
+    // residency manager (which needs the scheduler) textures only keep the mip levels the screen needs.
+    explicit Model(ModelData &&data, bool gamma = false, rg::UploadScheduler *uploads = nullptr,
+                   rg::TextureResidency *residency = nullptr) : gammaCorrection(gamma)
+    {
+        upload(std::move(data), uploads, residency);
+    }
+
+    // reads the model file with ASSIMP and converts its meshes without touching OpenGL, so it can run
+    // on any thread. With a pool the meshes are converted in parallel. Only the maps in usage are
+    // decoded, and tangents are only computed if usage asks for them.
+    static ModelData LoadData(string const &path, rg::ThreadPool *pool = nullptr, TextureUsage usage = TextureUsage::All())
+    {
+        ModelData data;
+        // a model cooked by tools/asset_cooker is only copied out of its .rgmesh, ASSIMP isn't needed
+        if (!loadBakedMeshes(path, usage, data.meshes))
+        {
+            // read file via ASSIMP (an Importer per call, so several models can be imported at once)
+            Assimp::Importer importer;
+            // the model and its .mtl come through the asset pack when one is mounted; the importer owns the handler
+            importer.SetIOHandler(new rg::AssetIOSystem());
+            unsigned int flags = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs;
+            if (usage.tangents)
+                flags |= aiProcess_CalcTangentSpace;
+            const aiScene* scene = importer.ReadFile(path, flags);
+            // check for errors
+            if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
+            {
+                cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
+                return data;
+            }
+
+            // walk ASSIMP's node tree recursively to get the meshes in draw order
+            vector<const aiMesh*> sceneMeshes;
+            sceneMeshes.reserve(scene->mNumMeshes);
+            processNode(scene->mRootNode, scene, sceneMeshes);
+
+            // meshes are independent of each other, convert them side by side
+            data.meshes.resize(sceneMeshes.size());
+            auto convert = [&](size_t i) {
+                data.meshes[i] = processMesh(sceneMeshes[i], scene, usage);
+            };
+            if (pool)
+                pool->ParallelFor(sceneMeshes.size(), convert);
+            else
+                for (size_t i = 0; i < sceneMeshes.size(); i++)
+                    convert(i);
+        }
+        // retrieve the directory path of the filepath
+        data.directory = path.substr(0, path.find_last_of('/'));
+
+        // decode the textures here as well, so the GL thread only has to upload them. The cache skips the
+        // ones another model already has on the GPU.
+        vector<pair<string, rg::TextureVariant>> paths;
+        for (const MeshData& mesh : data.meshes)
+            for (const TextureRef& ref : mesh.textures)
+                if (std::find(paths.begin(), paths.end(), std::make_pair(ref.path, ref.Variant())) == paths.end())
+                    paths.emplace_back(ref.path, ref.Variant());
+        vector<rg::TextureSource> sources(paths.size());
+        auto decode = [&](size_t i) {
+            sources[i] = rg::TextureCache::Instance().Load(data.directory + '/' + paths[i].first, paths[i].second);
+        };
+        if (pool)
+            pool->ParallelFor(paths.size(), decode);
+        else
+            for (size_t i = 0; i < paths.size(); i++)
+                decode(i);
+        for (size_t i = 0; i < paths.size(); i++)
+            data.textures.emplace(paths[i], std::move(sources[i]));
+        return data;
     }
 
     // draws the model, and thus all its meshes
@@ -47,56 +165,121 @@ public:
             meshes[i].Draw(shader);
     }
 
+    // drops the CPU-side vertices/indices of every mesh once they are on the GPU
+    void ReleaseGeometry() {
+        for (Mesh& mesh: meshes) {
+            mesh.ReleaseGeometry();
+        }
+    }
+
     void SetShaderTextureNamePrefix(std::string prefix) {
         for (Mesh& mesh: meshes) {
-            mesh.glslIdentifierPrefix = prefix;
+            mesh.SetShaderTextureNamePrefix(prefix);
         }
     }
 private:
-    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-    void loadModel(string const &path)
+    // creates the GL buffers and textures for data loaded by LoadData
+    void upload(ModelData &&data, rg::UploadScheduler *uploads = nullptr, rg::TextureResidency *residency = nullptr)
     {
-        // read file via ASSIMP
-        Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
-        // check for errors
-        if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
+        directory = std::move(data.directory);
+        calculateBounds(data);
+        meshes.reserve(data.meshes.size());
+        for (MeshData& mesh : data.meshes)
         {
-            cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
+            vector<Texture> textures;
+            textures.reserve(mesh.textures.size());
+            for (const TextureRef& ref : mesh.textures)
+                textures.push_back(loadTexture(ref, data.textures, uploads, residency));
+            meshes.emplace_back(std::move(mesh.vertices), std::move(mesh.indices), std::move(textures), uploads);
+        }
+    }
+
+    // sphere around the bounding box of all vertices
+    void calculateBounds(const ModelData &data)
+    {
+        glm::vec3 low(std::numeric_limits<float>::max());
+        glm::vec3 high(-std::numeric_limits<float>::max());
+        for (const MeshData& mesh : data.meshes)
+            for (const Vertex& vertex : mesh.vertices)
+            {
+                low = glm::min(low, vertex.Position);
+                high = glm::max(high, vertex.Position);
+            }
+        if (low.x > high.x)
             return;
+        boundsCenter = (low + high) * 0.5f;
+        boundsRadius = glm::length(high - boundsCenter);
+    }
+
+    // meshes from the model's .rgmesh; false if there is none, it lacks the tangents usage asks for or
+    // the source has changed since it was cooked. Without the source (a build shipping only cooked
+    // assets) it is used as it is.
+    static bool loadBakedMeshes(string const &path, const TextureUsage &usage, vector<MeshData> &meshes)
+    {
+        static_assert(sizeof(Vertex) == rg::BAKED_VERTEX_SIZE, "baked vertices are copied as they are");
+        rg::FileView file = rg::VirtualFileSystem::Instance().Read(rg::bakedModelPath(path));
+        if (!file)
+            return false;
+        rg::BakedModel baked = rg::parseBakedModel(file.data, file.size);
+        if (!baked || (usage.tangents && !baked.tangents))
+            return false;
+        rg::FileView source = rg::VirtualFileSystem::Instance().Read(path);
+        if (source)
+        {
+            uint64_t hash = rg::modelSourceHash(path, source.data, source.size, [](const string &library) -> uint64_t {
+                rg::FileView material = rg::VirtualFileSystem::Instance().Read(library);
+                return material ? rg::hashBytes(material.data, material.size) : 0;
+            });
+            if (hash != baked.sourceHash)
+            {
+                cout << "WARNING::MODEL:: " << rg::bakedModelPath(path) << " is older than " << path
+                     << ", loading the source; run asset_cooker to update it" << endl;
+                return false;
+            }
         }
-        // retrieve the directory path of the filepath
-        directory = path.substr(0, path.find_last_of('/'));
 
-        // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+        meshes.resize(baked.meshes.size());
+        for (size_t i = 0; i < baked.meshes.size(); i++)
+        {
+            const rg::BakedMesh& bakedMesh = baked.meshes[i];
+            MeshData& mesh = meshes[i];
+            mesh.vertices.resize(bakedMesh.vertexCount);
+            std::memcpy(mesh.vertices.data(), bakedMesh.vertices, bakedMesh.vertexCount * sizeof(Vertex));
+            mesh.indices.resize(bakedMesh.indexCount);
+            std::memcpy(mesh.indices.data(), bakedMesh.indices, bakedMesh.indexCount * sizeof(unsigned int));
+            for (const rg::BakedTexture& texture : bakedMesh.textures)
+                if (texture.type <= static_cast<uint8_t>(TextureType::Height) && usage.Uses(static_cast<TextureType>(texture.type)))
+                    mesh.textures.push_back(TextureRef{static_cast<TextureType>(texture.type), texture.path});
+        }
+        return true;
     }
 
-    // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode *node, const aiScene *scene)
+    // processes a node in a recursive fashion. Collects each individual mesh located at the node and repeats this process on its children nodes (if any).
+    static void processNode(const aiNode *node, const aiScene *scene, vector<const aiMesh*> &sceneMeshes)
     {
         // process each mesh located at the current node
         for(unsigned int i = 0; i < node->mNumMeshes; i++)
         {
             // the node object only contains indices to index the actual objects in the scene.
             // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
-            aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            sceneMeshes.push_back(scene->mMeshes[node->mMeshes[i]]);
         }
         // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
         for(unsigned int i = 0; i < node->mNumChildren; i++)
         {
-            processNode(node->mChildren[i], scene);
+            processNode(node->mChildren[i], scene, sceneMeshes);
         }
 
     }
 
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+    static MeshData processMesh(const aiMesh *mesh, const aiScene *scene, const TextureUsage &usage)
     {
         // data to fill
-        vector<Vertex> vertices;
-        vector<unsigned int> indices;
-        vector<Texture> textures;
+        MeshData data;
+        vector<Vertex>& vertices = data.vertices;
+        vector<unsigned int>& indices = data.indices;
+        vertices.reserve(mesh->mNumVertices);
+        indices.reserve(mesh->mNumFaces * 3);
 
         // walk through each of the mesh's vertices
         for(unsigned int i = 0; i < mesh->mNumVertices; i++)
@@ -125,6 +308,12 @@ private:
                 vec.x = mesh->mTextureCoords[0][i].x;
                 vec.y = mesh->mTextureCoords[0][i].y;
                 vertex.TexCoords = vec;
+            }
+            else
+                vertex.TexCoords = glm::vec2(0.0f, 0.0f);
+            // tangent space, only there if it was asked for
+            if (mesh->HasTangentsAndBitangents())
+            {
                 // tangent
                 vector.x = mesh->mTangents[i].x;
                 vector.y = mesh->mTangents[i].y;
@@ -137,7 +326,10 @@ private:
                 vertex.Bitangent = vector;
             }
             else
-                vertex.TexCoords = glm::vec2(0.0f, 0.0f);
+            {
+                vertex.Tangent = glm::vec3(0.0f);
+                vertex.Bitangent = glm::vec3(0.0f);
+            }
 
             vertices.push_back(vertex);
 
@@ -163,97 +355,110 @@ private:
         material->Get(AI_MATKEY_COLOR_AMBIENT, color);
 
 
+        // maps no program samples are left out, so they are never decoded, uploaded or bound
         // 1. diffuse maps
-        vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-        textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+        if (usage.Uses(TextureType::Diffuse))
+            loadMaterialTextures(material, aiTextureType_DIFFUSE, TextureType::Diffuse, data.textures);
         // 2. specular maps
-        vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-        textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+        if (usage.Uses(TextureType::Specular))
+            loadMaterialTextures(material, aiTextureType_SPECULAR, TextureType::Specular, data.textures);
         // 3. normal maps
-        std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
-        textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
+        if (usage.Uses(TextureType::Normal))
+            loadMaterialTextures(material, aiTextureType_HEIGHT, TextureType::Normal, data.textures);
         // 4. height maps
-        std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
-        textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
+        if (usage.Uses(TextureType::Height))
+            loadMaterialTextures(material, aiTextureType_AMBIENT, TextureType::Height, data.textures);
 
-
-
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        // return the extracted mesh data
+        return data;
     }
 
-    // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
-    vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
+    // collects all material textures of a given type; they are loaded later, on the GL thread.
+    static void loadMaterialTextures(const aiMaterial *mat, aiTextureType type, TextureType typeName, vector<TextureRef> &textures)
     {
-        vector<Texture> textures;
         for(unsigned int i = 0; i < mat->GetTextureCount(type); i++)
         {
             aiString str;
             mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
-            {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
-                }
-            }
-            if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
-            }
+            textures.push_back(TextureRef{typeName, str.C_Str()});
         }
-        return textures;
+    }
+
+    // looks the texture up in the process-wide cache and creates it from the decoded image if it isn't resident
+    Texture loadTexture(const TextureRef &ref, const map<pair<string, rg::TextureVariant>, rg::TextureSource> &sources,
+                        rg::UploadScheduler *uploads, rg::TextureResidency *residency)
+    {
+        auto source = sources.find(std::make_pair(ref.path, ref.Variant()));
+        rg::TextureSource loaded = source != sources.end() ? source->second
+                                                           : rg::TextureCache::Instance().Load(directory + '/' + ref.path, ref.Variant());
+        bool srgb = ref.IsColor();
+        rg::CachedTexture cached = rg::TextureCache::Instance().Acquire(loaded, [uploads, residency, srgb, &loaded](const std::shared_ptr<const rg::Image> &image) {
+            if (residency)
+                return residency->Create(image, loaded.path, srgb);
+            return uploads ? TextureFromImage(image, *uploads, srgb) : TextureFromImage(*image, srgb);
+        });
+        if (!cached)
+            std::cout << "Texture failed to load at path: " << ref.path << std::endl;
+
+        Texture texture;
+        texture.id = cached;
+        texture.type = ref.type;
+        texture.path = ref.path;
+        textureObjects.push_back(std::move(cached));
+        return texture;
     }
 };
 
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma)
+unsigned int TextureFromImage(const rg::Image &image, bool gamma)
 {
-    string filename = string(path);
-    filename = directory + '/' + filename;
-
     unsigned int textureID;
     glGenTextures(1, &textureID);
 
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
+    if (image)
     {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
         glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        rg::uploadImage(GL_TEXTURE_2D, image, gamma);
+        rg::finishMipChain(GL_TEXTURE_2D, image);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
     }
-    else
+
+    return textureID;
+}
+
+// same as above, but the pixels go through the upload scheduler; sampling is undefined until they arrive.
+// gamma stores the image as sRGB, for color maps.
+unsigned int TextureFromImage(std::shared_ptr<const rg::Image> image, rg::UploadScheduler &uploads, bool gamma)
+{
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+
+    if (*image)
     {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
+        uploads.UploadImage(textureID, GL_TEXTURE_2D, GL_TEXTURE_2D, std::move(image), true, gamma);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     }
 
     return textureID;
 }
+
+unsigned int TextureFromFile(const char *path, const string &directory, bool gamma)
+{
+    string filename = string(path);
+    filename = directory + '/' + filename;
+
+    rg::Image image = rg::loadImage(filename);
+    if (!image)
+        std::cout << "Texture failed to load at path: " << path << std::endl;
+
+    return TextureFromImage(image, gamma);
+}
 #endif
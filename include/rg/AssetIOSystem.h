@@ -0,0 +1,85 @@
+#ifndef PROJECT_BASE_ASSETIOSYSTEM_H
+#define PROJECT_BASE_ASSETIOSYSTEM_H
+
+#include <rg/VirtualFileSystem.h>
+
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+namespace rg {
+
+// Assimp stream over a FileView; reads are copies out of the pack mapping, nothing else touches the disk.
+class AssetIOStream : public Assimp::IOStream {
+public:
+    explicit AssetIOStream(FileView file)
+            : m_File(std::move(file)) {}
+
+    size_t Read(void* buffer, size_t size, size_t count) override {
+        if (size == 0) {
+            return 0;
+        }
+        count = std::min(count, (m_File.size - m_Position) / size);
+        std::memcpy(buffer, m_File.data + m_Position, size * count);
+        m_Position += size * count;
+        return count;
+    }
+
+    size_t Write(const void*, size_t, size_t) override {
+        return 0;
+    }
+
+    aiReturn Seek(size_t offset, aiOrigin origin) override {
+        size_t base = origin == aiOrigin_SET ? 0 : origin == aiOrigin_CUR ? m_Position : m_File.size;
+        if (offset > m_File.size - base) {
+            return aiReturn_FAILURE;
+        }
+        m_Position = base + offset;
+        return aiReturn_SUCCESS;
+    }
+
+    size_t Tell() const override {
+        return m_Position;
+    }
+
+    size_t FileSize() const override {
+        return m_File.size;
+    }
+
+    void Flush() override {}
+
+private:
+    FileView m_File;
+    size_t m_Position = 0;
+};
+
+// Lets Assimp read models and the files they reference (.mtl) through the VirtualFileSystem.
+// Read only: Open fails for any write mode.
+class AssetIOSystem : public Assimp::IOSystem {
+public:
+    bool Exists(const char* file) const override {
+        return VirtualFileSystem::Instance().Exists(file);
+    }
+
+    char getOsSeparator() const override {
+        return '/';
+    }
+
+    Assimp::IOStream* Open(const char* file, const char* mode = "rb") override {
+        if (std::strchr(mode, 'w') || std::strchr(mode, 'a') || std::strchr(mode, '+')) {
+            return nullptr;
+        }
+        FileView view = VirtualFileSystem::Instance().Read(file);
+        return view ? new AssetIOStream(std::move(view)) : nullptr;
+    }
+
+    void Close(Assimp::IOStream* stream) override {
+        delete stream;
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_ASSETIOSYSTEM_H
@@ -0,0 +1,287 @@
+#ifndef PROJECT_BASE_ASSETPACK_H
+#define PROJECT_BASE_ASSETPACK_H
+
+#include <rg/LZ4.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace rg {
+
+// Read-only view of a file's bytes. owner keeps them alive: the mapped pack for stored entries, a buffer
+// for decompressed entries and loose files. Cheap to copy.
+struct FileView {
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+    std::shared_ptr<const void> owner;
+
+    explicit operator bool() const {
+        return owner != nullptr;
+    }
+};
+
+// Asset pack layout, all little endian:
+//
+//   Header
+//   entry data, each entry starting at a multiple of ALIGNMENT
+//   Entry[entryCount]        at indexOffset
+//   entry names, not null terminated, at stringsOffset
+//
+// Names are '/' separated paths relative to the directory the pack sits in ("resources/textures/Corn.png").
+// Entries with FLAG_LZ4 hold an LZ4 block (rg/LZ4.h) of size bytes, the others their size bytes as is.
+namespace pack {
+
+const uint32_t MAGIC = 0x4B505247; // "GRPK"
+const uint32_t VERSION = 1;
+const uint32_t FLAG_LZ4 = 1;
+const size_t ALIGNMENT = 16;
+
+struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t reserved;
+    uint64_t indexOffset;
+    uint64_t stringsOffset;
+    uint64_t stringsSize;
+};
+static_assert(sizeof(Header) == 40, "pack header layout");
+
+struct Entry {
+    uint64_t offset;
+    uint64_t storedSize;
+    uint64_t size;
+    uint32_t nameOffset;
+    uint32_t nameLength;
+    uint32_t flags;
+    uint32_t reserved;
+};
+static_assert(sizeof(Entry) == 40, "pack entry layout");
+
+}
+
+// Lexically normalized path: repeated and trailing separators, "." and resolvable ".." are dropped.
+inline std::string normalizePath(const std::string& path) {
+    bool absolute = !path.empty() && path[0] == '/';
+    std::vector<std::string> parts;
+    size_t start = 0;
+    while (start <= path.size()) {
+        size_t end = path.find('/', start);
+        if (end == std::string::npos) {
+            end = path.size();
+        }
+        std::string part = path.substr(start, end - start);
+        if (part == "..") {
+            if (!parts.empty() && parts.back() != "..") {
+                parts.pop_back();
+            } else if (!absolute) {
+                parts.push_back(part);
+            }
+        } else if (!part.empty() && part != ".") {
+            parts.push_back(part);
+        }
+        start = end + 1;
+    }
+    std::string normalized = absolute ? "/" : "";
+    for (size_t i = 0; i < parts.size(); ++i) {
+        normalized += (i > 0 ? "/" : "") + parts[i];
+    }
+    return normalized;
+}
+
+// A pack file mapped into memory. Stored entries are served straight from the mapping; LZ4 entries are
+// decompressed into a buffer on every Find, so callers keep the view rather than finding again.
+class AssetPack {
+public:
+    // nullptr if the file is missing or not a valid pack
+    static std::shared_ptr<AssetPack> Open(const std::string& path) {
+        int descriptor = open(path.c_str(), O_RDONLY);
+        if (descriptor < 0) {
+            return nullptr;
+        }
+        struct stat info;
+        void* mapping = MAP_FAILED;
+        if (fstat(descriptor, &info) == 0 && info.st_size >= static_cast<off_t>(sizeof(pack::Header))) {
+            mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        }
+        // the mapping stays valid without the descriptor
+        close(descriptor);
+        if (mapping == MAP_FAILED) {
+            return nullptr;
+        }
+        std::shared_ptr<AssetPack> pack(new AssetPack(static_cast<const unsigned char*>(mapping), info.st_size));
+        return pack->readIndex() ? pack : nullptr;
+    }
+
+    ~AssetPack() {
+        munmap(const_cast<unsigned char*>(m_Data), m_Size);
+    }
+
+    AssetPack(const AssetPack&) = delete;
+    AssetPack& operator=(const AssetPack&) = delete;
+
+    // the entry named name, an empty view if there is none or it fails to decompress; self keeps the
+    // mapping alive for as long as the view is used
+    static FileView Find(const std::shared_ptr<const AssetPack>& self, const std::string& name) {
+        auto found = self->m_Index.find(name);
+        if (found == self->m_Index.end()) {
+            return FileView();
+        }
+        const pack::Entry& entry = *found->second;
+        FileView view;
+        if (entry.flags & pack::FLAG_LZ4) {
+            std::shared_ptr<std::vector<unsigned char>> buffer = std::make_shared<std::vector<unsigned char>>(entry.size);
+            if (!lz4Decompress(self->m_Data + entry.offset, entry.storedSize, buffer->data(), buffer->size())) {
+                return FileView();
+            }
+            view.data = buffer->data();
+            view.size = buffer->size();
+            view.owner = std::move(buffer);
+        } else {
+            view.data = self->m_Data + entry.offset;
+            view.size = entry.size;
+            view.owner = self;
+        }
+        return view;
+    }
+
+    bool Contains(const std::string& name) const {
+        return m_Index.count(name) != 0;
+    }
+
+    size_t EntryCount() const {
+        return m_Index.size();
+    }
+
+private:
+    const unsigned char* m_Data;
+    size_t m_Size;
+    std::unordered_map<std::string, const pack::Entry*> m_Index;
+
+    AssetPack(const unsigned char* data, size_t size)
+            : m_Data(data), m_Size(size) {}
+
+    bool readIndex() {
+        pack::Header header;
+        std::memcpy(&header, m_Data, sizeof(header));
+        if (header.magic != pack::MAGIC || header.version != pack::VERSION ||
+            header.indexOffset % alignof(pack::Entry) != 0 || header.indexOffset > m_Size ||
+            (m_Size - header.indexOffset) / sizeof(pack::Entry) < header.entryCount ||
+            header.stringsOffset > m_Size || m_Size - header.stringsOffset < header.stringsSize) {
+            return false;
+        }
+        const pack::Entry* entries = reinterpret_cast<const pack::Entry*>(m_Data + header.indexOffset);
+        const char* names = reinterpret_cast<const char*>(m_Data + header.stringsOffset);
+        m_Index.reserve(header.entryCount);
+        for (uint32_t i = 0; i < header.entryCount; ++i) {
+            const pack::Entry& entry = entries[i];
+            if (entry.nameOffset > header.stringsSize || header.stringsSize - entry.nameOffset < entry.nameLength ||
+                entry.offset > m_Size || m_Size - entry.offset < entry.storedSize ||
+                (!(entry.flags & pack::FLAG_LZ4) && entry.storedSize != entry.size)) {
+                return false;
+            }
+            m_Index.emplace(std::string(names + entry.nameOffset, entry.nameLength), &entry);
+        }
+        return true;
+    }
+};
+
+// Writes a pack entry by entry: data goes to the file as it is added, the index at Finish.
+class AssetPackWriter {
+public:
+    explicit AssetPackWriter(const std::string& path)
+            : m_Out(path, std::ios::binary | std::ios::trunc) {
+        pack::Header header = {};
+        m_Out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        m_Offset = sizeof(header);
+    }
+
+    explicit operator bool() const {
+        return static_cast<bool>(m_Out);
+    }
+
+    // The LZ4 block to store size bytes of data as, or nothing if that doesn't save at least an eighth,
+    // so already compressed formats (JPEG, PNG) stay as they are. Any thread, to compress in parallel.
+    static std::vector<unsigned char> Compress(const unsigned char* data, size_t size) {
+        std::vector<unsigned char> compressed = lz4Compress(data, size);
+        if (compressed.size() >= size - size / 8) {
+            compressed.clear();
+        }
+        return compressed;
+    }
+
+    // adds an entry whose stored bytes are already prepared (LZ4 block of size bytes if lz4)
+    void AddStored(const std::string& name, const unsigned char* stored, size_t storedSize, size_t size, bool lz4) {
+        size_t padding = (pack::ALIGNMENT - m_Offset % pack::ALIGNMENT) % pack::ALIGNMENT;
+        static const char zeros[pack::ALIGNMENT] = {};
+        m_Out.write(zeros, padding);
+        m_Offset += padding;
+
+        pack::Entry entry = {};
+        entry.offset = m_Offset;
+        entry.storedSize = storedSize;
+        entry.size = size;
+        entry.nameOffset = static_cast<uint32_t>(m_Names.size());
+        entry.nameLength = static_cast<uint32_t>(name.size());
+        entry.flags = lz4 ? pack::FLAG_LZ4 : 0;
+        m_Entries.push_back(entry);
+        m_Names += name;
+
+        m_Out.write(reinterpret_cast<const char*>(stored), storedSize);
+        m_Offset += storedSize;
+        m_StoredBytes += storedSize;
+        m_Bytes += size;
+    }
+
+    // writes the index and the header; false if anything failed to write
+    bool Finish() {
+        size_t padding = (alignof(pack::Entry) - m_Offset % alignof(pack::Entry)) % alignof(pack::Entry);
+        static const char zeros[alignof(pack::Entry)] = {};
+        m_Out.write(zeros, padding);
+        m_Offset += padding;
+
+        pack::Header header = {};
+        header.magic = pack::MAGIC;
+        header.version = pack::VERSION;
+        header.entryCount = static_cast<uint32_t>(m_Entries.size());
+        header.indexOffset = m_Offset;
+        header.stringsOffset = m_Offset + m_Entries.size() * sizeof(pack::Entry);
+        header.stringsSize = m_Names.size();
+        m_Out.write(reinterpret_cast<const char*>(m_Entries.data()), m_Entries.size() * sizeof(pack::Entry));
+        m_Out.write(m_Names.data(), m_Names.size());
+        m_Out.seekp(0);
+        m_Out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        m_Out.close();
+        return !m_Out.fail();
+    }
+
+    size_t Bytes() const {
+        return m_Bytes;
+    }
+
+    size_t StoredBytes() const {
+        return m_StoredBytes;
+    }
+
+private:
+    std::ofstream m_Out;
+    size_t m_Offset = 0;
+    size_t m_Bytes = 0;
+    size_t m_StoredBytes = 0;
+    std::vector<pack::Entry> m_Entries;
+    std::string m_Names;
+};
+
+}
+
+#endif //PROJECT_BASE_ASSETPACK_H
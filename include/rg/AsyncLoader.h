@@ -0,0 +1,95 @@
+#ifndef PROJECT_BASE_ASYNCLOADER_H
+#define PROJECT_BASE_ASYNCLOADER_H
+
+#include <rg/ThreadPool.h>
+
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <vector>
+
+namespace rg {
+
+template<typename T>
+bool isReady(const std::future<T>& future) {
+    return future.valid() && future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+// Runs the CPU part of a load (file reading, decoding, conversion) on the pool and the GL part
+// (upload) on the thread calling Update, which is the render loop. The frame loop keeps running
+// while assets load and each one shows up as soon as it has been uploaded.
+class AsyncLoader {
+public:
+    explicit AsyncLoader(ThreadPool& pool)
+            : m_Pool(pool) {}
+
+    // load() runs on a worker, upload(result) later on the GL thread
+    template<typename LoadJob, typename UploadJob>
+    void Load(LoadJob load, UploadJob upload) {
+        Await(m_Pool.Submit(std::move(load)), std::move(upload));
+    }
+
+    // upload(result) runs on the GL thread once the future is ready
+    template<typename T, typename UploadJob>
+    void Await(std::future<T> future, UploadJob upload) {
+        std::shared_ptr<std::future<T>> result = std::make_shared<std::future<T>>(std::move(future));
+        m_Pending.push_back([result, upload]() {
+            if (!isReady(*result)) {
+                return false;
+            }
+            upload(result->get());
+            return true;
+        });
+    }
+
+    // upload(results) runs on the GL thread once every future of the batch is ready
+    template<typename T, typename UploadJob>
+    void Await(std::vector<std::future<T>> futures, UploadJob upload) {
+        std::shared_ptr<std::vector<std::future<T>>> results =
+                std::make_shared<std::vector<std::future<T>>>(std::move(futures));
+        m_Pending.push_back([results, upload]() {
+            for (const std::future<T>& result : *results) {
+                if (!isReady(result)) {
+                    return false;
+                }
+            }
+            std::vector<T> values;
+            values.reserve(results->size());
+            for (std::future<T>& result : *results) {
+                values.push_back(result.get());
+            }
+            upload(std::move(values));
+            return true;
+        });
+    }
+
+    // uploads at most maxUploads finished loads, so a frame never pays for all of them at once
+    void Update(int maxUploads = 1) {
+        int uploads = 0;
+        for (size_t i = 0; i < m_Pending.size() && uploads < maxUploads;) {
+            if (m_Pending[i]()) {
+                m_Pending.erase(m_Pending.begin() + i);
+                ++uploads;
+            } else {
+                ++i;
+            }
+        }
+    }
+
+    bool Done() const {
+        return m_Pending.empty();
+    }
+
+    size_t Pending() const {
+        return m_Pending.size();
+    }
+
+private:
+    ThreadPool& m_Pool;
+    std::vector<std::function<bool()>> m_Pending;
+};
+
+}
+
+#endif //PROJECT_BASE_ASYNCLOADER_H
@@ -0,0 +1,215 @@
+#ifndef PROJECT_BASE_AUTOEXPOSURE_H
+#define PROJECT_BASE_AUTOEXPOSURE_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/shader.h>
+#include <rg/Compute.h>
+#include <rg/GLResource.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace rg {
+
+// Eye adaptation without reading anything back: the exposure is measured, smoothed and consumed on the
+// GPU, in a 1x1 RG32F texture holding the adapted luminance (r) and the exposure (g) for the composite
+// to fetch, so the CPU never waits for the frame.
+//
+// With compute shaders luminance_histogram.cs counts every scene pixel into a 256 bin log2 luminance
+// histogram and luminance_adapt.cs reduces that to the average log luminance of the non-black pixels.
+// Otherwise luminance_log.fs writes log2 luminance, weighted by whether the pixel isn't black, and the
+// weight into a 256 x 256 mipmapped texture; glGenerateMipmap averages both down to the last level, where
+// their ratio is the same average, coarser but on any 3.3 context. Either way the
+// adapted luminance then moves towards the measured one exponentially, faster towards bright scenes
+// than towards dark ones, and the exposure maps it to key.
+class AutoExposure {
+public:
+    static constexpr float MIN_LOG_LUMINANCE = -10.0f;
+    static constexpr float MAX_LOG_LUMINANCE = 8.0f; // the fire's light box is about 2^7.7
+    static const int BINS = 256;          // BINS in luminance_histogram.cs and luminance_adapt.cs
+    static const int LOG_SIZE = 256;      // of the fragment path's log luminance texture
+    static const int LOG_LEVELS = 9;      // log2(LOG_SIZE) + 1
+
+    // drawQuad draws a full screen quad with positions at location 0 and texture coordinates at 1
+    explicit AutoExposure(void (*drawQuad)())
+            : m_DrawQuad(drawQuad),
+              m_Log("resources/shaders/blur.vs", "resources/shaders/luminance_log.fs"),
+              m_Adapt("resources/shaders/blur.vs", "resources/shaders/luminance_adapt.fs"),
+              m_HistogramCompute("resources/shaders/luminance_histogram.cs"),
+              m_AdaptCompute("resources/shaders/luminance_adapt.cs") {
+        m_Log.use();
+        m_Log.setInt("scene", 0);
+        m_Log.setFloat("minLogLuminance", MIN_LOG_LUMINANCE);
+        m_Log.setFloat("maxLogLuminance", MAX_LOG_LUMINANCE);
+        m_Adapt.use();
+        m_Adapt.setInt("logLuminance", 0);
+        m_Adapt.setInt("previous", 1);
+        m_Adapt.setFloat("lastLevel", static_cast<float>(LOG_LEVELS - 1));
+
+        for (Target& target : m_Adaptation) {
+            target.texture = GLTexture::create();
+            target.framebuffer = GLFramebuffer::create();
+            glBindTexture(GL_TEXTURE_2D, target.texture);
+            // zero: not adapted yet, the first measurement is taken as it is
+            const float zero[2] = {0.0f, 0.0f};
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, 1, 1, 0, GL_RG, GL_FLOAT, zero);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            attach(target);
+        }
+    }
+
+    // exposure compensation in stops: the key is middle grey (0.18) times 2^compensation
+    void SetCompensation(float stops) {
+        m_Key = 0.18f * std::exp2(stops);
+    }
+
+    // adaptation rates per second towards brighter and towards darker scenes
+    void SetSpeed(float up, float down) {
+        m_SpeedUp = std::max(0.0f, up);
+        m_SpeedDown = std::max(0.0f, down);
+    }
+
+    void SetExposureRange(float minExposure, float maxExposure) {
+        m_MinExposure = minExposure;
+        m_MaxExposure = std::max(minExposure, maxExposure);
+    }
+
+    // measures with compute shaders when they are available
+    void SetComputeHistogram(bool compute) {
+        m_ComputeHistogram = compute;
+    }
+
+    bool ComputeHistogramAvailable() const {
+        return m_HistogramCompute && m_AdaptCompute;
+    }
+
+    // Measures scene, width x height, and adapts to it over deltaTime seconds. Returns the adaptation
+    // texture. Leaves the viewport and the framebuffer binding as they were.
+    GLuint Update(GLuint scene, int width, int height, float deltaTime) {
+        glActiveTexture(GL_TEXTURE0);
+        if (m_ComputeHistogram && ComputeHistogramAvailable()) {
+            measureCompute(scene, width, height, deltaTime);
+        } else {
+            measureFragment(scene, deltaTime);
+        }
+        return m_Adaptation[m_Current].texture;
+    }
+
+private:
+    struct Target {
+        GLTexture texture;
+        GLFramebuffer framebuffer;
+    };
+
+    void (*m_DrawQuad)();
+    Shader m_Log;
+    Shader m_Adapt;
+    ComputeShader m_HistogramCompute;
+    ComputeShader m_AdaptCompute;
+    float m_Key = 0.18f;
+    float m_SpeedUp = 3.0f;
+    float m_SpeedDown = 1.0f;
+    float m_MinExposure = 0.05f;
+    float m_MaxExposure = 8.0f;
+    bool m_ComputeHistogram = true;
+    GLBuffer m_Histogram;
+    Target m_LogLuminance;
+    // the fragment path can't read and write one texture, so it alternates; compute uses the current one
+    Target m_Adaptation[2];
+    int m_Current = 0;
+
+    static void attach(const Target& target) {
+        GLint framebuffer;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.texture, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    }
+
+    template<typename Program>
+    void setAdaptation(const Program& program, float deltaTime) const {
+        program.setFloat("deltaTime", deltaTime);
+        program.setFloat("speedUp", m_SpeedUp);
+        program.setFloat("speedDown", m_SpeedDown);
+        program.setFloat("key", m_Key);
+        program.setFloat("minExposure", m_MinExposure);
+        program.setFloat("maxExposure", m_MaxExposure);
+    }
+
+    void measureCompute(GLuint scene, int width, int height, float deltaTime) {
+        if (!m_Histogram) {
+            m_Histogram = GLBuffer::create();
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_Histogram);
+            // cleared once here, then by luminance_adapt.cs after every read
+            std::vector<GLuint> zeros(BINS, 0);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, BINS * sizeof(GLuint), zeros.data(), GL_DYNAMIC_COPY);
+        }
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_Histogram);
+
+        m_HistogramCompute.use();
+        m_HistogramCompute.setInt("scene", 0);
+        m_HistogramCompute.setFloat("minLogLuminance", MIN_LOG_LUMINANCE);
+        m_HistogramCompute.setFloat("inverseLogRange", 1.0f / (MAX_LOG_LUMINANCE - MIN_LOG_LUMINANCE));
+        glBindTexture(GL_TEXTURE_2D, scene);
+        dispatchCompute((width + 15) / 16, (height + 15) / 16);
+        memoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        m_AdaptCompute.use();
+        m_AdaptCompute.setFloat("minLogLuminance", MIN_LOG_LUMINANCE);
+        m_AdaptCompute.setFloat("logRange", MAX_LOG_LUMINANCE - MIN_LOG_LUMINANCE);
+        setAdaptation(m_AdaptCompute, deltaTime);
+        bindImageTexture(0, m_Adaptation[m_Current].texture, 0, GL_READ_WRITE, GL_RG32F);
+        dispatchCompute(1, 1);
+        // the composite fetches the exposure, the next frame's passes reuse the bins and the image
+        memoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+
+    void measureFragment(GLuint scene, float deltaTime) {
+        GLint viewport[4], framebuffer;
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+        GLboolean blend = glIsEnabled(GL_BLEND);
+        glDisable(GL_BLEND);
+
+        if (!m_LogLuminance.texture) {
+            m_LogLuminance.texture = GLTexture::create();
+            m_LogLuminance.framebuffer = GLFramebuffer::create();
+            glBindTexture(GL_TEXTURE_2D, m_LogLuminance.texture);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, LOG_SIZE, LOG_SIZE, 0, GL_RG, GL_FLOAT, NULL);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            attach(m_LogLuminance);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, m_LogLuminance.framebuffer);
+        glViewport(0, 0, LOG_SIZE, LOG_SIZE);
+        m_Log.use();
+        glBindTexture(GL_TEXTURE_2D, scene);
+        m_DrawQuad();
+        glBindTexture(GL_TEXTURE_2D, m_LogLuminance.texture);
+        glGenerateMipmap(GL_TEXTURE_2D);
+
+        int next = 1 - m_Current;
+        glBindFramebuffer(GL_FRAMEBUFFER, m_Adaptation[next].framebuffer);
+        glViewport(0, 0, 1, 1);
+        m_Adapt.use();
+        setAdaptation(m_Adapt, deltaTime);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, m_Adaptation[m_Current].texture);
+        glActiveTexture(GL_TEXTURE0);
+        m_DrawQuad();
+        m_Current = next;
+
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        if (blend) {
+            glEnable(GL_BLEND);
+        }
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_AUTOEXPOSURE_H
@@ -0,0 +1,191 @@
+#ifndef PROJECT_BASE_BAKEDMODEL_H
+#define PROJECT_BASE_BAKEDMODEL_H
+
+#include <rg/Hash.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace rg {
+
+// A model cooked by tools/asset_cooker: its meshes already triangulated, deduplicated and reordered for
+// the vertex cache, in the exact vertex layout the renderer uploads, so loading is a parse and a copy
+// instead of an ASSIMP import. Written next to the source (Cow.obj -> Cow.rgmesh), little endian. The
+// header keeps the modelSourceHash of what it was cooked from, so a loader can tell it is out of date:
+//
+//   Header
+//   per mesh: MeshHeader, textureCount x (uint8 type, uint8 0, uint16 path length, path),
+//             vertexCount x BAKED_VERTEX_SIZE bytes, indexCount x uint32
+namespace meshfile {
+
+const uint32_t MAGIC = 0x534D4752; // "RGMS"
+const uint32_t VERSION = 2;
+const uint32_t FLAG_TANGENTS = 1;
+
+struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t meshCount;
+    uint32_t flags;
+    uint64_t sourceHash;
+};
+
+struct MeshHeader {
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t textureCount;
+    uint32_t reserved;
+};
+
+}
+
+// position, normal, texture coordinates, tangent, bitangent: 14 floats, the layout of learnopengl's Vertex
+const size_t BAKED_VERTEX_SIZE = 14 * sizeof(float);
+
+// a material map, typed like learnopengl's TextureType and named relative to the model's directory
+struct BakedTexture {
+    uint8_t type;
+    std::string path;
+};
+
+// vertices and indices point into the parsed file (or, when writing, the cooker's buffers)
+struct BakedMesh {
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
+    const unsigned char* vertices = nullptr;
+    const unsigned char* indices = nullptr;
+    std::vector<BakedTexture> textures;
+};
+
+struct BakedModel {
+    bool tangents = false;
+    uint64_t sourceHash = 0;
+    std::vector<BakedMesh> meshes;
+
+    explicit operator bool() const {
+        return !meshes.empty();
+    }
+};
+
+inline std::string bakedModelPath(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return path + ".rgmesh";
+    }
+    return path.substr(0, dot) + ".rgmesh";
+}
+
+// material libraries an .obj names on its mtllib lines, relative to its directory
+inline std::vector<std::string> materialLibraries(const unsigned char* obj, size_t size) {
+    std::vector<std::string> libraries;
+    std::istringstream lines(std::string(reinterpret_cast<const char*>(obj), size));
+    std::string line;
+    while (std::getline(lines, line)) {
+        std::istringstream words(line);
+        std::string keyword, name;
+        if (words >> keyword && keyword == "mtllib") {
+            while (words >> name) {
+                libraries.push_back(name);
+            }
+        }
+    }
+    return libraries;
+}
+
+// Hash of what a model at path is cooked from: the .obj's size bytes and the material libraries it
+// names, each hashed by hashFile(path), which returns 0 for a missing file.
+template<typename HashFile>
+inline uint64_t modelSourceHash(const std::string& path, const unsigned char* obj, size_t size, HashFile hashFile) {
+    uint64_t hash = hashBytes(obj, size);
+    std::string directory = path.substr(0, path.find_last_of('/') + 1);
+    for (const std::string& library : materialLibraries(obj, size)) {
+        hash = combineHashes(hash, hashFile(directory + library));
+    }
+    return hash;
+}
+
+// Parses a baked model held in memory; the meshes point into file, which has to outlive them. Returns an
+// empty model for other versions and truncated files.
+inline BakedModel parseBakedModel(const unsigned char* file, size_t size) {
+    BakedModel model;
+    meshfile::Header header;
+    if (size < sizeof(header)) {
+        return model;
+    }
+    std::memcpy(&header, file, sizeof(header));
+    if (header.magic != meshfile::MAGIC || header.version != meshfile::VERSION) {
+        return model;
+    }
+    size_t offset = sizeof(header);
+    std::vector<BakedMesh> meshes(header.meshCount <= size ? header.meshCount : 0);
+    for (BakedMesh& mesh : meshes) {
+        meshfile::MeshHeader meshHeader;
+        if (size - offset < sizeof(meshHeader)) {
+            return model;
+        }
+        std::memcpy(&meshHeader, file + offset, sizeof(meshHeader));
+        offset += sizeof(meshHeader);
+        for (uint32_t i = 0; i < meshHeader.textureCount; ++i) {
+            if (size - offset < 4) {
+                return model;
+            }
+            uint16_t length;
+            std::memcpy(&length, file + offset + 2, sizeof(length));
+            if (size - offset - 4 < length) {
+                return model;
+            }
+            mesh.textures.push_back(BakedTexture{file[offset],
+                                                 std::string(reinterpret_cast<const char*>(file) + offset + 4, length)});
+            offset += 4 + length;
+        }
+        uint64_t vertexBytes = uint64_t(meshHeader.vertexCount) * BAKED_VERTEX_SIZE;
+        uint64_t indexBytes = uint64_t(meshHeader.indexCount) * sizeof(uint32_t);
+        if (size - offset < vertexBytes || size - offset - vertexBytes < indexBytes) {
+            return model;
+        }
+        mesh.vertexCount = meshHeader.vertexCount;
+        mesh.indexCount = meshHeader.indexCount;
+        mesh.vertices = file + offset;
+        mesh.indices = file + offset + vertexBytes;
+        offset += vertexBytes + indexBytes;
+    }
+    model.tangents = (header.flags & meshfile::FLAG_TANGENTS) != 0;
+    model.sourceHash = header.sourceHash;
+    model.meshes = std::move(meshes);
+    return model;
+}
+
+inline bool writeBakedModel(const std::string& path, const BakedModel& model) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        return false;
+    }
+    meshfile::Header header = {meshfile::MAGIC, meshfile::VERSION, static_cast<uint32_t>(model.meshes.size()),
+                               model.tangents ? meshfile::FLAG_TANGENTS : 0, model.sourceHash};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const BakedMesh& mesh : model.meshes) {
+        meshfile::MeshHeader meshHeader = {mesh.vertexCount, mesh.indexCount,
+                                           static_cast<uint32_t>(mesh.textures.size()), 0};
+        out.write(reinterpret_cast<const char*>(&meshHeader), sizeof(meshHeader));
+        for (const BakedTexture& texture : mesh.textures) {
+            unsigned char prefix[4] = {texture.type, 0};
+            uint16_t length = static_cast<uint16_t>(texture.path.size());
+            std::memcpy(prefix + 2, &length, sizeof(length));
+            out.write(reinterpret_cast<const char*>(prefix), sizeof(prefix));
+            out.write(texture.path.data(), length);
+        }
+        out.write(reinterpret_cast<const char*>(mesh.vertices), mesh.vertexCount * BAKED_VERTEX_SIZE);
+        out.write(reinterpret_cast<const char*>(mesh.indices), mesh.indexCount * sizeof(uint32_t));
+    }
+    out.close();
+    return !out.fail();
+}
+
+}
+
+#endif //PROJECT_BASE_BAKEDMODEL_H
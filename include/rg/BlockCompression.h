@@ -0,0 +1,302 @@
+#ifndef PROJECT_BASE_BLOCKCOMPRESSION_H
+#define PROJECT_BASE_BLOCKCOMPRESSION_H
+
+#include <rg/DDS.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace rg {
+
+// Offline BC1/BC3/BC4/BC5 encoder used to bake textures (tools/asset_cooker.cpp). Endpoints are
+// fitted along the principal axis of each block's colors, which is fast and good enough for the
+// diffuse maps and the skybox; BC7 files made by other tools load fine but aren't produced here.
+namespace bc {
+
+inline uint16_t packRGB565(const float color[3]) {
+    int r = static_cast<int>(std::round(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f));
+    int g = static_cast<int>(std::round(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f));
+    int b = static_cast<int>(std::round(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f));
+    return static_cast<uint16_t>(r << 11 | g << 5 | b);
+}
+
+inline void unpackRGB565(uint16_t packed, int color[3]) {
+    int r = packed >> 11 & 31;
+    int g = packed >> 5 & 63;
+    int b = packed & 31;
+    color[0] = r << 3 | r >> 2;
+    color[1] = g << 2 | g >> 4;
+    color[2] = b << 3 | b >> 2;
+}
+
+// 4x4 RGBA texels (alpha ignored) -> 8 byte BC1 block, always in four color mode so it also serves BC3
+inline void encodeColorBlock(const unsigned char rgba[64], unsigned char out[8]) {
+    float mean[3] = {0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 16; ++i) {
+        for (int c = 0; c < 3; ++c) {
+            mean[c] += rgba[i * 4 + c] / 16.0f;
+        }
+    }
+    float covariance[6] = {0.0f}; // rr rg rb gg gb bb
+    for (int i = 0; i < 16; ++i) {
+        float r = rgba[i * 4] - mean[0];
+        float g = rgba[i * 4 + 1] - mean[1];
+        float b = rgba[i * 4 + 2] - mean[2];
+        covariance[0] += r * r;
+        covariance[1] += r * g;
+        covariance[2] += r * b;
+        covariance[3] += g * g;
+        covariance[4] += g * b;
+        covariance[5] += b * b;
+    }
+    // principal axis by power iteration
+    float axis[3] = {1.0f, 1.0f, 1.0f};
+    for (int iteration = 0; iteration < 8; ++iteration) {
+        float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+        float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+        float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+        float length = std::max(std::max(std::fabs(x), std::fabs(y)), std::fabs(z));
+        if (length < 1e-6f) {
+            break;
+        }
+        axis[0] = x / length;
+        axis[1] = y / length;
+        axis[2] = z / length;
+    }
+    float axisLengthSquared = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+
+    float minProjection = 0.0f;
+    float maxProjection = 0.0f;
+    for (int i = 0; i < 16; ++i) {
+        float projection = 0.0f;
+        for (int c = 0; c < 3; ++c) {
+            projection += (rgba[i * 4 + c] - mean[c]) * axis[c];
+        }
+        projection /= axisLengthSquared;
+        minProjection = std::min(minProjection, projection);
+        maxProjection = std::max(maxProjection, projection);
+    }
+    // pull the endpoints in a little, the interpolated colors cover the extremes well enough
+    float inset = (maxProjection - minProjection) / 16.0f;
+    float endpoints[2][3];
+    for (int c = 0; c < 3; ++c) {
+        endpoints[0][c] = mean[c] + axis[c] * (maxProjection - inset);
+        endpoints[1][c] = mean[c] + axis[c] * (minProjection + inset);
+    }
+    uint16_t color0 = packRGB565(endpoints[0]);
+    uint16_t color1 = packRGB565(endpoints[1]);
+    if (color0 < color1) {
+        std::swap(color0, color1);
+    }
+
+    uint32_t indices = 0;
+    if (color0 != color1) {
+        int palette[4][3];
+        unpackRGB565(color0, palette[0]);
+        unpackRGB565(color1, palette[1]);
+        for (int c = 0; c < 3; ++c) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        for (int i = 0; i < 16; ++i) {
+            int best = 0;
+            int bestDistance = 1 << 30;
+            for (int p = 0; p < 4; ++p) {
+                int distance = 0;
+                for (int c = 0; c < 3; ++c) {
+                    int d = rgba[i * 4 + c] - palette[p][c];
+                    distance += d * d;
+                }
+                if (distance < bestDistance) {
+                    bestDistance = distance;
+                    best = p;
+                }
+            }
+            indices |= static_cast<uint32_t>(best) << (2 * i);
+        }
+    }
+    out[0] = color0 & 0xFF;
+    out[1] = color0 >> 8;
+    out[2] = color1 & 0xFF;
+    out[3] = color1 >> 8;
+    for (int i = 0; i < 4; ++i) {
+        out[4 + i] = indices >> (8 * i) & 0xFF;
+    }
+}
+
+// 16 single channel values -> 8 byte BC4 block (also the alpha half of BC3 and each half of BC5)
+inline void encodeChannelBlock(const unsigned char values[16], unsigned char out[8]) {
+    int high = *std::max_element(values, values + 16);
+    int low = *std::min_element(values, values + 16);
+    uint64_t indices = 0;
+    if (high != low) {
+        // eight value mode: index 0 = high, 1 = low, 2..7 interpolate from high to low
+        for (int i = 0; i < 16; ++i) {
+            int step = static_cast<int>(std::round((high - values[i]) * 7.0f / (high - low)));
+            int index = step == 0 ? 0 : step == 7 ? 1 : step + 1;
+            indices |= static_cast<uint64_t>(index) << (3 * i);
+        }
+    }
+    out[0] = static_cast<unsigned char>(high);
+    out[1] = static_cast<unsigned char>(low);
+    for (int i = 0; i < 6; ++i) {
+        out[2 + i] = indices >> (8 * i) & 0xFF;
+    }
+}
+
+// encodes one 4x4 block of texels, read from an RGBA8 level with edge texels repeated past the border
+inline void encodeBlock(BlockFormat format, const unsigned char* rgba, int width, int height,
+                        int blockX, int blockY, unsigned char* out) {
+    unsigned char texels[64];
+    for (int y = 0; y < 4; ++y) {
+        for (int x = 0; x < 4; ++x) {
+            int sourceX = std::min(blockX * 4 + x, width - 1);
+            int sourceY = std::min(blockY * 4 + y, height - 1);
+            const unsigned char* texel = rgba + (static_cast<size_t>(sourceY) * width + sourceX) * 4;
+            std::copy(texel, texel + 4, texels + (y * 4 + x) * 4);
+        }
+    }
+    unsigned char channel[16];
+    auto extract = [&](int c) {
+        for (int i = 0; i < 16; ++i) {
+            channel[i] = texels[i * 4 + c];
+        }
+    };
+    switch (format) {
+        case BlockFormat::BC1:
+            encodeColorBlock(texels, out);
+            break;
+        case BlockFormat::BC3:
+            extract(3);
+            encodeChannelBlock(channel, out);
+            encodeColorBlock(texels, out + 8);
+            break;
+        case BlockFormat::BC4:
+            extract(0);
+            encodeChannelBlock(channel, out);
+            break;
+        case BlockFormat::BC5:
+            extract(0);
+            encodeChannelBlock(channel, out);
+            extract(1);
+            encodeChannelBlock(channel, out + 8);
+            break;
+        case BlockFormat::BC7:
+            break;
+    }
+}
+
+// sRGB encoded bytes to linear light, and back to the nearest byte
+struct SRGBTable {
+    float linear[256];
+    float midpoints[255]; // linear value halfway between neighbouring bytes
+
+    SRGBTable() {
+        for (int i = 0; i < 256; ++i) {
+            float encoded = i / 255.0f;
+            linear[i] = encoded <= 0.04045f ? encoded / 12.92f : std::pow((encoded + 0.055f) / 1.055f, 2.4f);
+        }
+        for (int i = 0; i < 255; ++i) {
+            midpoints[i] = 0.5f * (linear[i] + linear[i + 1]);
+        }
+    }
+
+    unsigned char encode(float value) const {
+        return static_cast<unsigned char>(std::upper_bound(midpoints, midpoints + 255, value) - midpoints);
+    }
+};
+
+inline const SRGBTable& srgbTable() {
+    static const SRGBTable table;
+    return table;
+}
+
+// 2x2 box filter, what glGenerateMipmap does: with srgb the color channels of 3 and 4 channel images
+// are averaged in linear light, as GL filters GL_SRGB8 and GL_SRGB8_ALPHA8, and alpha as it is
+inline std::vector<unsigned char> downsample(const std::vector<unsigned char>& pixels, int width, int height,
+                                             int channels = 4, bool srgb = false) {
+    const SRGBTable& table = srgbTable();
+    int colorChannels = srgb && channels >= 3 ? 3 : 0;
+    int halfWidth = std::max(width / 2, 1);
+    int halfHeight = std::max(height / 2, 1);
+    std::vector<unsigned char> half(static_cast<size_t>(halfWidth) * halfHeight * channels);
+    for (int y = 0; y < halfHeight; ++y) {
+        for (int x = 0; x < halfWidth; ++x) {
+            int x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+            int y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+            const unsigned char* p00 = &pixels[(static_cast<size_t>(y0) * width + x0) * channels];
+            const unsigned char* p01 = &pixels[(static_cast<size_t>(y0) * width + x1) * channels];
+            const unsigned char* p10 = &pixels[(static_cast<size_t>(y1) * width + x0) * channels];
+            const unsigned char* p11 = &pixels[(static_cast<size_t>(y1) * width + x1) * channels];
+            unsigned char* out = &half[(static_cast<size_t>(y) * halfWidth + x) * channels];
+            for (int c = 0; c < channels; ++c) {
+                if (c < colorChannels) {
+                    float sum = table.linear[p00[c]] + table.linear[p01[c]] + table.linear[p10[c]] + table.linear[p11[c]];
+                    out[c] = table.encode(0.25f * sum);
+                } else {
+                    out[c] = static_cast<unsigned char>((p00[c] + p01[c] + p10[c] + p11[c] + 2) / 4);
+                }
+            }
+        }
+    }
+    return half;
+}
+
+}
+
+// Compresses an RGBA8 image and every mip level below it down to 1x1, filtering the levels in linear light
+// for a color image that is sampled as sRGB (srgb). BC7 is not supported by this encoder.
+inline CompressedImage compressImage(const unsigned char* rgba, int width, int height, BlockFormat format,
+                                     bool srgb = false) {
+    CompressedImage image;
+    if (format == BlockFormat::BC7) {
+        return image;
+    }
+    image.format = format;
+    image.width = width;
+    image.height = height;
+
+    std::vector<unsigned char> level(rgba, rgba + static_cast<size_t>(width) * height * 4);
+    std::vector<unsigned char> blocks;
+    for (;;) {
+        int blocksX = (width + 3) / 4;
+        int blocksY = (height + 3) / 4;
+        size_t bytes = blockBytes(format);
+        blocks.resize(blocksX * blocksY * bytes);
+        for (int y = 0; y < blocksY; ++y) {
+            for (int x = 0; x < blocksX; ++x) {
+                bc::encodeBlock(format, level.data(), width, height, x, y, &blocks[(y * blocksX + x) * bytes]);
+            }
+        }
+        image.AddLevel(width, height, blocks.data());
+        if (width == 1 && height == 1) {
+            break;
+        }
+        level = bc::downsample(level, width, height, 4, srgb);
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+    }
+    return image;
+}
+
+// smallest format that keeps the image's channels; RGBA images whose alpha is all opaque become BC1
+inline BlockFormat chooseBlockFormat(const unsigned char* rgba, int width, int height, int channels) {
+    switch (channels) {
+        case 1: return BlockFormat::BC4;
+        case 2: return BlockFormat::BC5;
+        case 3: return BlockFormat::BC1;
+        default:
+            for (size_t i = 0, count = static_cast<size_t>(width) * height; i < count; ++i) {
+                if (rgba[i * 4 + 3] != 255) {
+                    return BlockFormat::BC3;
+                }
+            }
+            return BlockFormat::BC1;
+    }
+}
+
+}
+
+#endif //PROJECT_BASE_BLOCKCOMPRESSION_H
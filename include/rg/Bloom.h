@@ -0,0 +1,401 @@
+#ifndef PROJECT_BASE_BLOOM_H
+#define PROJECT_BASE_BLOOM_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/shader.h>
+#include <rg/Compute.h>
+#include <rg/GLResource.h>
+#include <rg/RenderTargets.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace rg {
+
+enum class BloomMode : int {
+    MipChain, // progressive 13-tap downsample and tent upsample over a half resolution mip chain
+    Gaussian  // thresholded copy at half resolution, then separable Gaussian ping-pong
+};
+
+// normalized Gaussian weights for the offsets 0..radius, sigma radius / 2
+inline std::vector<float> gaussianWeights(int radius) {
+    std::vector<float> weights(radius + 1);
+    float sigma = std::max(radius, 1) * 0.5f;
+    float sum = 0.0f;
+    for (int i = 0; i <= radius; ++i) {
+        weights[i] = std::exp(-0.5f * i * i / (sigma * sigma));
+        sum += i == 0 ? weights[i] : 2.0f * weights[i];
+    }
+    for (float& weight : weights) {
+        weight /= sum;
+    }
+    return weights;
+}
+
+// The same kernel with each pair of neighbouring taps i, i + 1 folded into one bilinear fetch at
+// i + w(i + 1) / (w(i) + w(i + 1)), which returns exactly their weighted mix, so radius taps per side
+// take (radius + 1) / 2 fetches (the 9-tap kernel 5 instead of 9). Index 0 is the center.
+inline void linearTaps(const std::vector<float>& weights, std::vector<float>& offsets, std::vector<float>& tapWeights) {
+    offsets.assign(1, 0.0f);
+    tapWeights.assign(1, weights[0]);
+    for (size_t i = 1; i < weights.size(); i += 2) {
+        float second = i + 1 < weights.size() ? weights[i + 1] : 0.0f;
+        float weight = weights[i] + second;
+        offsets.push_back(i + second / weight);
+        tapWeights.push_back(weight);
+    }
+}
+
+// Blurs the bright parts of the HDR scene for the composite to add back.
+//
+// MipChain halves the resolution up to MAX_LEVELS times with the 13-tap filter from Jimenez, "Next
+// Generation Post Processing in Call of Duty: Advanced Warfare", the first pass also applying the
+// soft-knee threshold, so no separate bright pass is needed. It then walks back up, adding a 3x3 tent
+// upsample of every level onto the one above. Each pass touches a quarter of the pixels of the
+// previous one, so the whole chain costs about as much as two full screen passes, against the ten
+// of the Gaussian, and reaches much further.
+//
+// Gaussian is the original ping-pong blur, kept for comparison. It blurs a bright pass taken from the
+// HDR scene at half resolution with the same threshold, rather than a second scene attachment. With
+// compute shaders (rg/Compute.h) each pass runs as blur.cs: a work group loads its row segment plus
+// the kernel radius on both sides into shared memory once and every invocation reads its taps from
+// there, about one texture fetch per pixel whatever the radius. Otherwise blur.fs runs with the
+// taps folded into bilinear fetches (linearTaps).
+//
+// Both run on RGBA16F or, at half the bytes, R11F_G11F_B10F targets (SetFormat), and can start from
+// half the scene's resolution (SetHalfResolution).
+class Bloom {
+public:
+    static const int MAX_LEVELS = 8;
+    static const int MAX_BLUR_RADIUS = 16; // MAX_RADIUS in blur.cs, twice the taps blur.fs takes
+
+    // drawQuad draws a full screen quad with positions at location 0 and texture coordinates at 1
+    explicit Bloom(void (*drawQuad)())
+            : m_DrawQuad(drawQuad),
+              m_Downsample("resources/shaders/blur.vs", "resources/shaders/bloom_downsample.fs"),
+              m_Upsample("resources/shaders/blur.vs", "resources/shaders/bloom_upsample.fs"),
+              m_BrightPass("resources/shaders/blur.vs", "resources/shaders/bloom_bright.fs"),
+              m_Blur("resources/shaders/blur.vs", "resources/shaders/blur.fs"),
+              m_BlurCompute("resources/shaders/blur.cs"),
+              m_BlurComputePacked("resources/shaders/blur.cs", "#define DESTINATION_FORMAT r11f_g11f_b10f\n") {
+        m_Downsample.use();
+        m_Downsample.setInt("source", 0);
+        m_Upsample.use();
+        m_Upsample.setInt("source", 0);
+        m_BrightPass.use();
+        m_BrightPass.setInt("scene", 0);
+        m_Blur.use();
+        m_Blur.setInt("image", 0);
+    }
+
+    // size of the scene; the targets are reallocated when it changes
+    void Resize(int width, int height) {
+        if (width == m_Width && height == m_Height) {
+            return;
+        }
+        m_Width = width;
+        m_Height = height;
+        m_Levels.clear();
+        m_Pingpong.clear();
+    }
+
+    // internal format of the targets, GL_RGBA16F or GL_R11F_G11F_B10F
+    void SetFormat(GLenum format) {
+        if (format != m_Format) {
+            m_Format = format;
+            m_Levels.clear();
+            m_Pingpong.clear();
+        }
+    }
+
+    // start the mip chain, or the bright pass, from half the scene's resolution
+    void SetHalfResolution(bool half) {
+        if (half != m_HalfResolution) {
+            m_HalfResolution = half;
+            m_Levels.clear();
+            m_Pingpong.clear();
+        }
+    }
+
+    void SetMode(BloomMode mode) {
+        m_Mode = mode;
+    }
+
+    BloomMode Mode() const {
+        return m_Mode;
+    }
+
+    // brightness from which the scene blooms, and the width of the soft transition below it
+    void SetThreshold(float threshold, float knee) {
+        m_Threshold = threshold;
+        m_Knee = knee;
+    }
+
+    // number of mip chain levels, the first at half resolution; more levels spread the glow further
+    void SetLevelCount(int levels) {
+        levels = std::max(1, std::min<int>(levels, MAX_LEVELS));
+        if (levels != m_LevelCount) {
+            m_LevelCount = levels;
+            m_Levels.clear();
+        }
+    }
+
+    int LevelCount() const {
+        return m_LevelCount;
+    }
+
+    // tent filter radius of the upsample, in texels of the level it reads
+    void SetRadius(float radius) {
+        m_Radius = radius;
+    }
+
+    // separable Gaussian passes, horizontal and vertical alternating
+    void SetBlurPasses(int passes) {
+        m_BlurPasses = std::max(2, passes);
+    }
+
+    // Gaussian taps on each side of a pixel per pass
+    void SetBlurRadius(int radius) {
+        m_BlurRadius = std::max(1, std::min<int>(radius, MAX_BLUR_RADIUS));
+    }
+
+    // runs the Gaussian passes as compute shaders when they are available
+    void SetComputeBlur(bool compute) {
+        m_ComputeBlur = compute;
+    }
+
+    bool ComputeBlurAvailable() const {
+        return static_cast<bool>(computeBlurShader());
+    }
+
+    // What the composite adds to the scene (its HDR color), times Strength(). Leaves the viewport,
+    // blending and the framebuffer binding as they were.
+    GLuint Render(GLuint scene) {
+        GLint viewport[4], framebuffer, blendSource, blendDestination;
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+        glGetIntegerv(GL_BLEND_SRC_RGB, &blendSource);
+        glGetIntegerv(GL_BLEND_DST_RGB, &blendDestination);
+        GLboolean blend = glIsEnabled(GL_BLEND);
+        glActiveTexture(GL_TEXTURE0);
+
+        GLuint result = m_Mode == BloomMode::MipChain ? renderMipChain(scene) : renderGaussian(scene);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        glBlendFunc(blendSource, blendDestination);
+        if (blend) {
+            glEnable(GL_BLEND);
+        } else {
+            glDisable(GL_BLEND);
+        }
+        return result;
+    }
+
+    // Estimate of the bytes the current mode moves per frame with targets of format, from half the
+    // scene's resolution if halfResolution: each target pixel written once and read once per pass that
+    // uses it, twice where the upsample blends onto it, the composite's read included. Like
+    // RenderTargets::EstimateFrameBytes, only good for comparisons.
+    size_t EstimateFrameBytes(GLenum format, bool halfResolution) const {
+        int width = halfResolution ? std::max(1, m_Width / 2) : m_Width;
+        int height = halfResolution ? std::max(1, m_Height / 2) : m_Height;
+        if (m_Mode == BloomMode::Gaussian) {
+            size_t pixels = static_cast<size_t>(std::max(1, width / 2)) * std::max(1, height / 2);
+            // bright pass, blur passes, composite
+            return pixels * targetPixelSize(format) * (2 + 2 * m_BlurPasses);
+        }
+        std::vector<size_t> levels;
+        for (int i = 0; i < m_LevelCount && width > 1 && height > 1; ++i) {
+            width = std::max(1, width / 2);
+            height = std::max(1, height / 2);
+            levels.push_back(static_cast<size_t>(width) * height);
+        }
+        size_t pixels = levels.empty() ? 0 : levels[0]; // the composite's read
+        for (size_t i = 0; i < levels.size(); ++i) {
+            pixels += levels[i]; // downsampled into
+            if (i + 1 < levels.size()) {
+                pixels += 3 * levels[i]; // read by the next downsample, blended onto by the upsample
+            }
+            if (i > 0) {
+                pixels += levels[i]; // upsampled from
+            }
+        }
+        return pixels * targetPixelSize(format);
+    }
+
+    // the mip chain adds up every level, each carrying about as much light as the bright pass
+    float Strength() const {
+        return m_Mode == BloomMode::MipChain ? 1.0f / m_LevelCount : 1.0f;
+    }
+
+private:
+    struct Target {
+        GLTexture texture;
+        GLFramebuffer framebuffer;
+        int width;
+        int height;
+    };
+
+    void (*m_DrawQuad)();
+    Shader m_Downsample;
+    Shader m_Upsample;
+    Shader m_BrightPass;
+    Shader m_Blur;
+    ComputeShader m_BlurCompute;
+    ComputeShader m_BlurComputePacked; // writing R11F_G11F_B10F images
+    BloomMode m_Mode = BloomMode::MipChain;
+    int m_Width = 0;
+    int m_Height = 0;
+    GLenum m_Format = GL_RGBA16F;
+    bool m_HalfResolution = false;
+    float m_Threshold = 1.0f;
+    float m_Knee = 0.5f;
+    int m_LevelCount = 6;
+    float m_Radius = 1.0f;
+    int m_BlurPasses = 10;
+    int m_BlurRadius = 4;
+    bool m_ComputeBlur = true;
+    std::vector<Target> m_Levels;
+    std::vector<Target> m_Pingpong; // the bright pass, then the blur passes alternating
+
+    const ComputeShader& computeBlurShader() const {
+        return m_Format == GL_R11F_G11F_B10F ? m_BlurComputePacked : m_BlurCompute;
+    }
+
+    // the size the mip chain and the bright pass start from
+    int baseWidth() const {
+        return m_HalfResolution ? std::max(1, m_Width / 2) : m_Width;
+    }
+
+    int baseHeight() const {
+        return m_HalfResolution ? std::max(1, m_Height / 2) : m_Height;
+    }
+
+    Target createTarget(int width, int height) const {
+        Target target{GLTexture::create(), GLFramebuffer::create(), width, height};
+        glBindTexture(GL_TEXTURE_2D, target.texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, m_Format, width, height, 0, targetPixelFormat(m_Format), GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        // clamped, as the filters would otherwise pull in the opposite edge
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.texture, 0);
+        return target;
+    }
+
+    void bindTarget(const Target& target) {
+        glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+        glViewport(0, 0, target.width, target.height);
+    }
+
+    GLuint renderMipChain(GLuint scene) {
+        if (m_Levels.empty()) {
+            int width = baseWidth(), height = baseHeight();
+            for (int i = 0; i < m_LevelCount && width > 1 && height > 1; ++i) {
+                width = std::max(1, width / 2);
+                height = std::max(1, height / 2);
+                m_Levels.push_back(createTarget(width, height));
+            }
+        }
+        if (m_Levels.empty()) {
+            return 0;
+        }
+
+        // every texel is written, nothing to blend with
+        glDisable(GL_BLEND);
+        m_Downsample.use();
+        m_Downsample.setFloat("threshold", m_Threshold);
+        m_Downsample.setFloat("knee", m_Knee);
+        for (size_t i = 0; i < m_Levels.size(); ++i) {
+            bindTarget(m_Levels[i]);
+            m_Downsample.setBool("prefilter", i == 0);
+            glBindTexture(GL_TEXTURE_2D, i == 0 ? scene : static_cast<GLuint>(m_Levels[i - 1].texture));
+            m_DrawQuad();
+        }
+
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+        m_Upsample.use();
+        m_Upsample.setFloat("radius", m_Radius);
+        for (size_t i = m_Levels.size() - 1; i > 0; --i) {
+            bindTarget(m_Levels[i - 1]);
+            glBindTexture(GL_TEXTURE_2D, m_Levels[i].texture);
+            m_DrawQuad();
+        }
+        return m_Levels.front().texture;
+    }
+
+    GLuint renderGaussian(GLuint scene) {
+        if (m_Pingpong.empty()) {
+            for (int i = 0; i < 2; ++i) {
+                m_Pingpong.push_back(createTarget(std::max(1, baseWidth() / 2), std::max(1, baseHeight() / 2)));
+            }
+        }
+
+        // the bright pass goes to the buffer the first (horizontal) blur pass reads
+        glDisable(GL_BLEND);
+        bindTarget(m_Pingpong[0]);
+        m_BrightPass.use();
+        m_BrightPass.setFloat("threshold", m_Threshold);
+        m_BrightPass.setFloat("knee", m_Knee);
+        m_BrightPass.setBool("wide", m_HalfResolution);
+        glBindTexture(GL_TEXTURE_2D, scene);
+        m_DrawQuad();
+        GLuint bright = m_Pingpong[0].texture;
+
+        std::vector<float> weights = gaussianWeights(m_BlurRadius);
+        return m_ComputeBlur && computeBlurShader() ? blurCompute(bright, weights) : blurFragment(bright, weights);
+    }
+
+    GLuint blurFragment(GLuint bright, const std::vector<float>& weights) {
+        std::vector<float> offsets, tapWeights;
+        linearTaps(weights, offsets, tapWeights);
+
+        m_Blur.use();
+        m_Blur.setInt("tapCount", static_cast<int>(offsets.size()));
+        glUniform1fv(glGetUniformLocation(m_Blur.ID, "offsets"), static_cast<GLsizei>(offsets.size()), offsets.data());
+        glUniform1fv(glGetUniformLocation(m_Blur.ID, "weights"), static_cast<GLsizei>(tapWeights.size()), tapWeights.data());
+        bool horizontal = true;
+        for (int i = 0; i < m_BlurPasses; ++i) {
+            bindTarget(m_Pingpong[horizontal]);
+            m_Blur.setBool("horizontal", horizontal);
+            // the bright pass first, then the other buffer's result
+            glBindTexture(GL_TEXTURE_2D, i == 0 ? bright : static_cast<GLuint>(m_Pingpong[!horizontal].texture));
+            m_DrawQuad();
+            horizontal = !horizontal;
+        }
+        return m_Pingpong[!horizontal].texture;
+    }
+
+    GLuint blurCompute(GLuint bright, const std::vector<float>& weights) {
+        // the segment of a row (or column) one work group blurs, local_size_x in blur.cs
+        const GLuint tile = 128;
+        const ComputeShader& shader = computeBlurShader();
+        shader.use();
+        shader.setInt("source", 0);
+        shader.setInt("radius", m_BlurRadius);
+        shader.setFloats("weights", weights.data(), static_cast<int>(weights.size()));
+        bool horizontal = true;
+        for (int i = 0; i < m_BlurPasses; ++i) {
+            const Target& target = m_Pingpong[horizontal];
+            shader.setBool("horizontal", horizontal);
+            glBindTexture(GL_TEXTURE_2D, i == 0 ? bright : static_cast<GLuint>(m_Pingpong[!horizontal].texture));
+            bindImageTexture(0, target.texture, 0, GL_WRITE_ONLY, m_Format);
+            GLuint length = horizontal ? target.width : target.height;
+            GLuint lines = horizontal ? target.height : target.width;
+            dispatchCompute((length + tile - 1) / tile, lines);
+            // the next pass and the composite sample what this one stored
+            memoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+            horizontal = !horizontal;
+        }
+        return m_Pingpong[!horizontal].texture;
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_BLOOM_H
@@ -0,0 +1,118 @@
+#ifndef PROJECT_BASE_COLORLUT_H
+#define PROJECT_BASE_COLORLUT_H
+
+#include <glad/glad.h>
+
+#include <rg/GLResource.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace rg {
+
+// the grading folded into the LUT, applied to the exposed scene color before the tone curve
+struct ColorGrading {
+    float filter[3] = {1.0f, 1.0f, 1.0f}; // linear multiplier per channel, for white balance or a tint
+    float contrast = 1.0f;                // slope in log2 space around middle grey
+    float saturation = 1.0f;              // 0 is grey, 1 as rendered
+
+    bool operator==(const ColorGrading& other) const {
+        return std::equal(filter, filter + 3, other.filter) && contrast == other.contrast &&
+               saturation == other.saturation;
+    }
+
+    bool operator!=(const ColorGrading& other) const {
+        return !(*this == other);
+    }
+};
+
+// Everything the composite does to an exposed HDR color, baked into a SIZE^3 3D texture: the grading,
+// the 1 - exp(-x) tone curve and the sRGB encoding, so the composite looks the result up with one
+// filtered fetch instead of evaluating exp and pow per pixel. Exposure changes every frame with auto
+// exposure, so it stays in the shader, in front of the lookup.
+//
+// The LUT's coordinates are log2 encoded, which spends the samples evenly across stops instead of on
+// the highlights: a channel x maps to (log2(x + 2^MIN_LOG) - MIN_LOG) / (MAX_LOG - MIN_LOG), so 0 lands
+// exactly on the first sample and stays black, and everything from 2^MAX_LOG up is white anyway. The
+// composite does the encoding (bloom.fs, with the uniforms from SetUniforms). The table is baked on the
+// CPU, at construction and whenever SetGrading changes it: 32K texels, a few milliseconds.
+class ColorLut {
+public:
+    static const int SIZE = 32;
+    static constexpr float MIN_LOG = -12.0f;
+    static constexpr float MAX_LOG = 4.0f;
+
+    ColorLut() {
+        bake();
+    }
+
+    // rebakes the table if grading differs from the one it holds
+    void SetGrading(const ColorGrading& grading) {
+        if (grading != m_Grading) {
+            m_Grading = grading;
+            bake();
+        }
+    }
+
+    GLuint Texture() const {
+        return m_Texture;
+    }
+
+    // sets the encoding uniforms of the composite's program, which has to be in use
+    template<typename Program>
+    static void SetUniforms(const Program& program) {
+        program.setFloat("lutMinLog", MIN_LOG);
+        program.setFloat("lutOffset", std::exp2(MIN_LOG));
+        program.setFloat("lutLogRange", MAX_LOG - MIN_LOG);
+        program.setFloat("lutSize", static_cast<float>(SIZE));
+    }
+
+private:
+    GLTexture m_Texture = GLTexture::create();
+    ColorGrading m_Grading;
+
+    static float decode(int index) {
+        float t = static_cast<float>(index) / (SIZE - 1);
+        return std::exp2(t * (MAX_LOG - MIN_LOG) + MIN_LOG) - std::exp2(MIN_LOG);
+    }
+
+    static float linearToSRGB(float value) {
+        return value < 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    }
+
+    void bake() {
+        std::vector<float> texels(3 * SIZE * SIZE * SIZE);
+        float* texel = texels.data();
+        for (int b = 0; b < SIZE; ++b) {
+            for (int g = 0; g < SIZE; ++g) {
+                for (int r = 0; r < SIZE; ++r) {
+                    float color[3] = {decode(r), decode(g), decode(b)};
+                    for (int c = 0; c < 3; ++c) {
+                        color[c] *= m_Grading.filter[c];
+                        // grey stays where it is, contrast spreads the stops around it
+                        color[c] = color[c] > 0.0f ? 0.18f * std::pow(color[c] / 0.18f, m_Grading.contrast) : 0.0f;
+                    }
+                    float luminance = 0.2126f * color[0] + 0.7152f * color[1] + 0.0722f * color[2];
+                    for (int c = 0; c < 3; ++c) {
+                        float saturated = std::max(0.0f, luminance + (color[c] - luminance) * m_Grading.saturation);
+                        *texel++ = linearToSRGB(1.0f - std::exp(-saturated));
+                    }
+                }
+            }
+        }
+        glBindTexture(GL_TEXTURE_3D, m_Texture);
+        // half floats: the encoded values are all in [0, 1], where that is better than 10 bits
+        glTexImage3D(GL_TEXTURE_3D, 0, GL_RGB16F, SIZE, SIZE, SIZE, 0, GL_RGB, GL_FLOAT, texels.data());
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_3D, 0);
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_COLORLUT_H
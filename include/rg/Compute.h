@@ -0,0 +1,165 @@
+#ifndef PROJECT_BASE_COMPUTE_H
+#define PROJECT_BASE_COMPUTE_H
+
+#include <glad/glad.h>
+
+#include <common.h>
+#include <rg/GLResource.h>
+
+#include <iostream>
+#include <string>
+
+// GL 4.3 compute tokens, missing from the 3.3 core profile glad was generated for
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+#ifndef GL_TEXTURE_FETCH_BARRIER_BIT
+#define GL_TEXTURE_FETCH_BARRIER_BIT 0x00000008
+#endif
+#ifndef GL_SHADER_IMAGE_ACCESS_BARRIER_BIT
+#define GL_SHADER_IMAGE_ACCESS_BARRIER_BIT 0x00000020
+#endif
+#ifndef GL_SHADER_STORAGE_BARRIER_BIT
+#define GL_SHADER_STORAGE_BARRIER_BIT 0x00002000
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+
+namespace rg {
+
+namespace compute {
+
+typedef void (APIENTRYP DispatchComputeProc)(GLuint groupsX, GLuint groupsY, GLuint groupsZ);
+typedef void (APIENTRYP BindImageTextureProc)(GLuint unit, GLuint texture, GLint level, GLboolean layered,
+                                              GLint layer, GLenum access, GLenum format);
+typedef void (APIENTRYP MemoryBarrierProc)(GLbitfield barriers);
+
+struct Functions {
+    DispatchComputeProc dispatchCompute = nullptr;
+    BindImageTextureProc bindImageTexture = nullptr;
+    MemoryBarrierProc memoryBarrier = nullptr;
+};
+
+inline Functions& functions() {
+    static Functions functions;
+    return functions;
+}
+
+}
+
+// Loads the compute entry points with load, the function glad was loaded with (glfwGetProcAddress),
+// if the context is GL 4.3 or newer. The shaders are #version 430 and bind with layout(binding), so the
+// ARB_compute_shader extension on an older context isn't enough. The window only asks for 3.3, but most
+// drivers hand out their newest core version anyway. Until this succeeds computeSupported() is false and
+// the fragment shader paths are used.
+inline bool loadComputeFunctions(GLADloadproc load) {
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    bool supported = major > 4 || (major == 4 && minor >= 3);
+    compute::Functions functions;
+    if (supported) {
+        functions.dispatchCompute = reinterpret_cast<compute::DispatchComputeProc>(load("glDispatchCompute"));
+        functions.bindImageTexture = reinterpret_cast<compute::BindImageTextureProc>(load("glBindImageTexture"));
+        functions.memoryBarrier = reinterpret_cast<compute::MemoryBarrierProc>(load("glMemoryBarrier"));
+    }
+    if (!functions.dispatchCompute || !functions.bindImageTexture || !functions.memoryBarrier) {
+        functions = compute::Functions();
+    }
+    compute::functions() = functions;
+    return functions.dispatchCompute != nullptr;
+}
+
+inline bool computeSupported() {
+    return compute::functions().dispatchCompute != nullptr;
+}
+
+inline void dispatchCompute(GLuint groupsX, GLuint groupsY, GLuint groupsZ = 1) {
+    compute::functions().dispatchCompute(groupsX, groupsY, groupsZ);
+}
+
+inline void bindImageTexture(GLuint unit, GLuint texture, GLint level, GLenum access, GLenum format) {
+    compute::functions().bindImageTexture(unit, texture, level, GL_FALSE, 0, access, format);
+}
+
+inline void memoryBarrier(GLbitfield barriers) {
+    compute::functions().memoryBarrier(barriers);
+}
+
+// A compute program, the single stage counterpart of Shader. Evaluates to false when compute shaders
+// aren't supported or the source doesn't compile, so callers can fall back to their fragment path.
+// defines, lines of #define, go in right after the #version line.
+class ComputeShader {
+public:
+    explicit ComputeShader(const std::string& path, const std::string& defines = "") {
+        if (!computeSupported()) {
+            return;
+        }
+        std::string code = readFileContents(path);
+        if (code.empty()) {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ " << path << std::endl;
+            return;
+        }
+        if (!defines.empty()) {
+            size_t versionEnd = code.find('\n');
+            code.insert(versionEnd == std::string::npos ? code.size() : versionEnd + 1, defines);
+        }
+        const char* source = code.c_str();
+        GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
+        glShaderSource(shader, 1, &source, NULL);
+        glCompileShader(shader);
+        GLint success;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (!success) {
+            GLchar infoLog[1024];
+            glGetShaderInfoLog(shader, 1024, NULL, infoLog);
+            std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: COMPUTE (" << path << ")\n" << infoLog << std::endl;
+            glDeleteShader(shader);
+            return;
+        }
+        GLProgram program = GLProgram::create();
+        glAttachShader(program, shader);
+        glLinkProgram(program);
+        glDeleteShader(shader);
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            GLchar infoLog[1024];
+            glGetProgramInfoLog(program, 1024, NULL, infoLog);
+            std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: COMPUTE (" << path << ")\n" << infoLog << std::endl;
+            return;
+        }
+        m_Program = std::move(program);
+    }
+
+    explicit operator bool() const {
+        return m_Program != 0;
+    }
+
+    void use() const {
+        glUseProgram(m_Program);
+    }
+
+    void setInt(const std::string& name, int value) const {
+        glUniform1i(glGetUniformLocation(m_Program, name.c_str()), value);
+    }
+
+    void setBool(const std::string& name, bool value) const {
+        setInt(name, value);
+    }
+
+    void setFloat(const std::string& name, float value) const {
+        glUniform1f(glGetUniformLocation(m_Program, name.c_str()), value);
+    }
+
+    void setFloats(const std::string& name, const float* values, int count) const {
+        glUniform1fv(glGetUniformLocation(m_Program, name.c_str()), count, values);
+    }
+
+private:
+    GLProgram m_Program;
+};
+
+}
+
+#endif //PROJECT_BASE_COMPUTE_H
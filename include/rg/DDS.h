@@ -0,0 +1,310 @@
+#ifndef PROJECT_BASE_DDS_H
+#define PROJECT_BASE_DDS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace rg {
+
+// GPU block-compressed formats; every one of them encodes 4x4 texel blocks
+enum class BlockFormat : uint8_t {
+    BC1, // RGB, 8 bytes per block (DXT1)
+    BC3, // RGBA, 16 bytes per block (DXT5)
+    BC4, // R, 8 bytes per block (RGTC1)
+    BC5, // RG, 16 bytes per block (RGTC2)
+    BC7  // RGBA, 16 bytes per block (BPTC)
+};
+
+inline size_t blockBytes(BlockFormat format) {
+    return format == BlockFormat::BC1 || format == BlockFormat::BC4 ? 8 : 16;
+}
+
+inline int blockChannels(BlockFormat format) {
+    switch (format) {
+        case BlockFormat::BC1: return 3;
+        case BlockFormat::BC4: return 1;
+        case BlockFormat::BC5: return 2;
+        default: return 4;
+    }
+}
+
+inline size_t compressedLevelSize(BlockFormat format, int width, int height) {
+    size_t blocksX = (width + 3) / 4;
+    size_t blocksY = (height + 3) / 4;
+    return blocksX * blocksY * blockBytes(format);
+}
+
+struct MipLevel {
+    int width;
+    int height;
+    size_t offset; // into CompressedImage::data
+    size_t size;
+};
+
+// block-compressed image with its mip chain, largest level first
+struct CompressedImage {
+    BlockFormat format = BlockFormat::BC1;
+    int width = 0;
+    int height = 0;
+    uint64_t sourceHash = 0; // hashBytes of the file it was baked from, 0 if the file doesn't say
+    std::vector<MipLevel> levels;
+    std::vector<unsigned char> data;
+
+    explicit operator bool() const {
+        return !levels.empty();
+    }
+
+    // appends the next mip level; its blocks are copied from blocks
+    void AddLevel(int levelWidth, int levelHeight, const unsigned char* blocks) {
+        MipLevel level{levelWidth, levelHeight, data.size(), compressedLevelSize(format, levelWidth, levelHeight)};
+        data.insert(data.end(), blocks, blocks + level.size);
+        levels.push_back(level);
+    }
+};
+
+// where the baked version of a source texture lives: next to it, with the extension replaced by .dds
+inline std::string compressedPath(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return path + ".dds";
+    }
+    return path.substr(0, dot) + ".dds";
+}
+
+namespace dds {
+
+const uint32_t MAGIC = 0x20534444; // "DDS "
+
+const uint32_t FLAG_CAPS = 0x1;
+const uint32_t FLAG_HEIGHT = 0x2;
+const uint32_t FLAG_WIDTH = 0x4;
+const uint32_t FLAG_PIXELFORMAT = 0x1000;
+const uint32_t FLAG_MIPMAPCOUNT = 0x20000;
+const uint32_t FLAG_LINEARSIZE = 0x80000;
+const uint32_t PIXELFORMAT_FOURCC = 0x4;
+const uint32_t CAPS_COMPLEX = 0x8;
+const uint32_t CAPS_TEXTURE = 0x1000;
+const uint32_t CAPS_MIPMAP = 0x400000;
+const uint32_t CAPS2_CUBEMAP = 0x200;
+
+const uint32_t DXGI_BC1_UNORM = 71;
+const uint32_t DXGI_BC1_UNORM_SRGB = 72;
+const uint32_t DXGI_BC3_UNORM = 77;
+const uint32_t DXGI_BC3_UNORM_SRGB = 78;
+const uint32_t DXGI_BC4_UNORM = 80;
+const uint32_t DXGI_BC5_UNORM = 83;
+const uint32_t DXGI_BC7_UNORM = 98;
+const uint32_t DXGI_BC7_UNORM_SRGB = 99;
+const uint32_t DIMENSION_TEXTURE2D = 3;
+
+inline constexpr uint32_t fourCC(char a, char b, char c, char d) {
+    return uint32_t(uint8_t(a)) | uint32_t(uint8_t(b)) << 8 | uint32_t(uint8_t(c)) << 16 | uint32_t(uint8_t(d)) << 24;
+}
+
+// The asset cooker records the source hash in the reserved words of the header: this tag in
+// reserved1[0], then the hash, low word first. Other writers leave them zero or put their own tags there.
+const uint32_t SOURCE_HASH_TAG = fourCC('R', 'G', 'S', 'H');
+
+struct PixelFormat {
+    uint32_t size;
+    uint32_t flags;
+    uint32_t fourCC;
+    uint32_t rgbBitCount;
+    uint32_t masks[4];
+};
+
+struct Header {
+    uint32_t size;
+    uint32_t flags;
+    uint32_t height;
+    uint32_t width;
+    uint32_t pitchOrLinearSize;
+    uint32_t depth;
+    uint32_t mipMapCount;
+    uint32_t reserved1[11];
+    PixelFormat pixelFormat;
+    uint32_t caps;
+    uint32_t caps2;
+    uint32_t caps3;
+    uint32_t caps4;
+    uint32_t reserved2;
+};
+
+struct HeaderDX10 {
+    uint32_t dxgiFormat;
+    uint32_t resourceDimension;
+    uint32_t miscFlag;
+    uint32_t arraySize;
+    uint32_t miscFlags2;
+};
+
+static_assert(sizeof(Header) == 124, "DDS header layout");
+static_assert(sizeof(HeaderDX10) == 20, "DDS DX10 header layout");
+
+inline bool formatFromFourCC(uint32_t code, BlockFormat& format) {
+    if (code == fourCC('D', 'X', 'T', '1')) {
+        format = BlockFormat::BC1;
+    } else if (code == fourCC('D', 'X', 'T', '5')) {
+        format = BlockFormat::BC3;
+    } else if (code == fourCC('A', 'T', 'I', '1') || code == fourCC('B', 'C', '4', 'U')) {
+        format = BlockFormat::BC4;
+    } else if (code == fourCC('A', 'T', 'I', '2') || code == fourCC('B', 'C', '5', 'U')) {
+        format = BlockFormat::BC5;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+inline bool formatFromDXGI(uint32_t dxgiFormat, BlockFormat& format) {
+    switch (dxgiFormat) {
+        case DXGI_BC1_UNORM: case DXGI_BC1_UNORM_SRGB: format = BlockFormat::BC1; return true;
+        case DXGI_BC3_UNORM: case DXGI_BC3_UNORM_SRGB: format = BlockFormat::BC3; return true;
+        case DXGI_BC4_UNORM: format = BlockFormat::BC4; return true;
+        case DXGI_BC5_UNORM: format = BlockFormat::BC5; return true;
+        case DXGI_BC7_UNORM: case DXGI_BC7_UNORM_SRGB: format = BlockFormat::BC7; return true;
+        default: return false;
+    }
+}
+
+}
+
+// Parses a DDS file held in memory that contains a single block-compressed 2D image (legacy
+// DXT1/DXT5/ATI1/ATI2 FourCCs or a DX10 header for BC1/3/4/5/7). Returns an empty image for anything
+// else: cube maps, arrays, uncompressed formats, impossible sizes or level counts and truncated data.
+// Never throws on bad headers, it runs on decode workers. Touches no GL state.
+inline CompressedImage parseDDS(const unsigned char* file, size_t fileSize) {
+    CompressedImage image;
+
+    uint32_t magic;
+    dds::Header header;
+    if (fileSize < sizeof(magic) + sizeof(header)) {
+        return image;
+    }
+    std::memcpy(&magic, file, sizeof(magic));
+    std::memcpy(&header, file + sizeof(magic), sizeof(header));
+    size_t offset = sizeof(magic) + sizeof(header);
+    if (magic != dds::MAGIC || header.size != sizeof(header) || (header.caps2 & dds::CAPS2_CUBEMAP) ||
+        !(header.pixelFormat.flags & dds::PIXELFORMAT_FOURCC) || header.width == 0 || header.height == 0 ||
+        header.width > 65536 || header.height > 65536) {
+        return image;
+    }
+
+    BlockFormat format;
+    if (header.pixelFormat.fourCC == dds::fourCC('D', 'X', '1', '0')) {
+        dds::HeaderDX10 dx10;
+        if (fileSize < offset + sizeof(dx10)) {
+            return image;
+        }
+        std::memcpy(&dx10, file + offset, sizeof(dx10));
+        offset += sizeof(dx10);
+        if (dx10.resourceDimension != dds::DIMENSION_TEXTURE2D || dx10.arraySize > 1 ||
+            !dds::formatFromDXGI(dx10.dxgiFormat, format)) {
+            return image;
+        }
+    } else if (!dds::formatFromFourCC(header.pixelFormat.fourCC, format)) {
+        return image;
+    }
+
+    // a full chain has 1 + floor(log2(max(width, height))) levels; a header asking for more is broken
+    uint32_t maxLevelCount = 1;
+    for (uint32_t size = std::max(header.width, header.height); size > 1; size /= 2) {
+        ++maxLevelCount;
+    }
+    uint32_t mipMapCount = (header.flags & dds::FLAG_MIPMAPCOUNT) && header.mipMapCount > 0 ? header.mipMapCount : 1;
+    if (mipMapCount > maxLevelCount) {
+        return image;
+    }
+    int levelCount = static_cast<int>(mipMapCount);
+    image.format = format;
+    image.width = header.width;
+    image.height = header.height;
+    if (header.reserved1[0] == dds::SOURCE_HASH_TAG) {
+        image.sourceHash = uint64_t(header.reserved1[1]) | uint64_t(header.reserved1[2]) << 32;
+    }
+    image.levels.reserve(levelCount);
+    int width = image.width;
+    int height = image.height;
+    for (int i = 0; i < levelCount; ++i) {
+        size_t size = compressedLevelSize(format, width, height);
+        if (fileSize < offset + size) {
+            break;
+        }
+        image.levels.push_back(MipLevel{width, height, offset, size});
+        offset += size;
+        if (width == 1 && height == 1) {
+            break;
+        }
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    if (image.levels.size() != static_cast<size_t>(levelCount)) {
+        return CompressedImage();
+    }
+
+    // keep only the blocks, the levels become offsets into them
+    size_t dataStart = image.levels.front().offset;
+    for (MipLevel& level : image.levels) {
+        level.offset -= dataStart;
+    }
+    image.data.assign(file + dataStart, file + offset);
+    return image;
+}
+
+// Writes the image as DDS. BC1/3/4/5 use the legacy FourCCs every reader understands, BC7 needs the DX10 header.
+// A sourceHash goes into the reserved header words, which other readers ignore.
+inline bool writeDDS(const std::string& path, const CompressedImage& image) {
+    if (!image) {
+        return false;
+    }
+    dds::Header header;
+    std::memset(&header, 0, sizeof(header));
+    header.size = sizeof(header);
+    header.flags = dds::FLAG_CAPS | dds::FLAG_HEIGHT | dds::FLAG_WIDTH | dds::FLAG_PIXELFORMAT |
+                   dds::FLAG_LINEARSIZE;
+    header.height = image.height;
+    header.width = image.width;
+    header.pitchOrLinearSize = static_cast<uint32_t>(image.levels.front().size);
+    header.mipMapCount = static_cast<uint32_t>(image.levels.size());
+    if (image.sourceHash != 0) {
+        header.reserved1[0] = dds::SOURCE_HASH_TAG;
+        header.reserved1[1] = static_cast<uint32_t>(image.sourceHash);
+        header.reserved1[2] = static_cast<uint32_t>(image.sourceHash >> 32);
+    }
+    header.caps = dds::CAPS_TEXTURE;
+    if (image.levels.size() > 1) {
+        header.flags |= dds::FLAG_MIPMAPCOUNT;
+        header.caps |= dds::CAPS_COMPLEX | dds::CAPS_MIPMAP;
+    }
+    header.pixelFormat.size = sizeof(dds::PixelFormat);
+    header.pixelFormat.flags = dds::PIXELFORMAT_FOURCC;
+    switch (image.format) {
+        case BlockFormat::BC1: header.pixelFormat.fourCC = dds::fourCC('D', 'X', 'T', '1'); break;
+        case BlockFormat::BC3: header.pixelFormat.fourCC = dds::fourCC('D', 'X', 'T', '5'); break;
+        case BlockFormat::BC4: header.pixelFormat.fourCC = dds::fourCC('A', 'T', 'I', '1'); break;
+        case BlockFormat::BC5: header.pixelFormat.fourCC = dds::fourCC('A', 'T', 'I', '2'); break;
+        case BlockFormat::BC7: header.pixelFormat.fourCC = dds::fourCC('D', 'X', '1', '0'); break;
+    }
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        return false;
+    }
+    out.write(reinterpret_cast<const char*>(&dds::MAGIC), sizeof(dds::MAGIC));
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (image.format == BlockFormat::BC7) {
+        dds::HeaderDX10 dx10{dds::DXGI_BC7_UNORM, dds::DIMENSION_TEXTURE2D, 0, 1, 0};
+        out.write(reinterpret_cast<const char*>(&dx10), sizeof(dx10));
+    }
+    out.write(reinterpret_cast<const char*>(image.data.data()), image.data.size());
+    return static_cast<bool>(out);
+}
+
+}
+
+#endif //PROJECT_BASE_DDS_H
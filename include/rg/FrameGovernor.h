@@ -0,0 +1,147 @@
+#ifndef PROJECT_BASE_FRAMEGOVERNOR_H
+#define PROJECT_BASE_FRAMEGOVERNOR_H
+
+#include <algorithm>
+#include <cmath>
+
+namespace rg {
+
+// the knobs the governor turns, as chosen in the settings and as it applies them
+struct QualitySettings {
+    float renderScale = 1.0f;
+    int bloomLevels = 6;
+    int blurPasses = 10;
+    float vegetationDistance = 40.0f;
+    float mipBias = 0.0f; // added to the texture residency's level choice
+};
+
+// Keeps the GPU frame time under a target by stepping down a fixed ladder of quality levels, resolution
+// first, and back up when there is room again.
+//
+// Samples (from a GpuTimer) are smoothed with an exponential average. A step down needs DOWN_FRAMES
+// averages in a row over the target, a step up UP_FRAMES in a row under UP_MARGIN of it, and also that
+// the step above is predicted to fit: its resolution scales the pixel cost by the ratio of the areas.
+// After every step the governor holds still for SETTLE_SECONDS, long enough for the render targets to
+// be reallocated (RESIZE_DELAY) and the queries to report frames rendered at the new level, so it
+// doesn't react to its own changes.
+class FrameGovernor {
+public:
+    static const int DOWN_FRAMES = 10;
+    static const int UP_FRAMES = 90;
+    static const int STEP_COUNT = 7;
+
+    FrameGovernor() = default;
+
+    void SetEnabled(bool enabled) {
+        if (enabled != m_Enabled) {
+            m_Enabled = enabled;
+            m_Step = 0;
+            m_Over = m_Under = 0;
+        }
+    }
+
+    bool Enabled() const {
+        return m_Enabled;
+    }
+
+    // GPU time per frame to stay under, in milliseconds
+    void SetTarget(float milliseconds) {
+        m_Target = std::max(1.0f, milliseconds);
+    }
+
+    float Target() const {
+        return m_Target;
+    }
+
+    // one frame's GPU time in milliseconds; now is glfwGetTime()
+    void Update(float milliseconds, double now) {
+        m_Average = m_Samples == 0 ? milliseconds : m_Average + SMOOTHING * (milliseconds - m_Average);
+        ++m_Samples;
+        if (!m_Enabled || now - m_ChangedAt < SETTLE_SECONDS) {
+            m_Over = m_Under = 0;
+            return;
+        }
+        m_Over = m_Average > m_Target ? m_Over + 1 : 0;
+        m_Under = m_Average < m_Target * UP_MARGIN ? m_Under + 1 : 0;
+        if (m_Over >= DOWN_FRAMES && m_Step + 1 < STEP_COUNT) {
+            change(m_Step + 1, now);
+        } else if (m_Under >= UP_FRAMES && m_Step > 0) {
+            float current = steps()[m_Step].renderScale, above = steps()[m_Step - 1].renderScale;
+            float predicted = m_Average * (above * above) / (current * current);
+            if (predicted < m_Target * UP_MARGIN) {
+                change(m_Step - 1, now);
+            } else {
+                m_Under = 0;
+            }
+        }
+    }
+
+    // the settings to render with this frame: requested, lowered by the current step
+    QualitySettings Apply(const QualitySettings& requested) const {
+        const Step& step = steps()[m_Step];
+        QualitySettings applied = requested;
+        applied.renderScale = requested.renderScale * step.renderScale;
+        applied.bloomLevels = std::max(std::min(requested.bloomLevels, 3), requested.bloomLevels - step.bloomLevelsDropped);
+        applied.blurPasses = std::max(2, static_cast<int>(std::lround(requested.blurPasses * step.blurPasses)));
+        applied.vegetationDistance = requested.vegetationDistance * step.vegetationDistance;
+        applied.mipBias = requested.mipBias + step.mipBias;
+        return applied;
+    }
+
+    // 0 is full quality, STEP_COUNT - 1 the lowest
+    int CurrentStep() const {
+        return m_Step;
+    }
+
+    // the smoothed GPU frame time in milliseconds
+    float AverageTime() const {
+        return m_Average;
+    }
+
+private:
+    // fractions of the requested settings, apart from the levels dropped and the mip bias added
+    struct Step {
+        float renderScale;
+        int bloomLevelsDropped;
+        float blurPasses;
+        float vegetationDistance;
+        float mipBias;
+    };
+
+    static constexpr float SMOOTHING = 0.1f;
+    static constexpr float UP_MARGIN = 0.85f;
+    static constexpr double SETTLE_SECONDS = 0.5;
+
+    bool m_Enabled = true;
+    float m_Target = 16.6f;
+    int m_Step = 0;
+    int m_Over = 0;
+    int m_Under = 0;
+    float m_Average = 0.0f;
+    long m_Samples = 0;
+    double m_ChangedAt = 0.0;
+
+    static const Step* steps() {
+        // resolution goes first, the other knobs only once it is noticeably lower
+        static const Step table[STEP_COUNT] = {
+                {1.0f, 0, 1.0f, 1.0f, 0.0f},
+                {0.9f, 0, 1.0f, 1.0f, 0.0f},
+                {0.8f, 0, 1.0f, 0.85f, 0.0f},
+                {0.75f, 1, 0.8f, 0.75f, 0.5f},
+                {0.67f, 1, 0.6f, 0.65f, 0.5f},
+                {0.6f, 2, 0.6f, 0.55f, 1.0f},
+                {0.5f, 3, 0.4f, 0.5f, 1.0f},
+        };
+        return table;
+    }
+
+    void change(int step, double now) {
+        m_Step = step;
+        m_ChangedAt = now;
+        m_Over = m_Under = 0;
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_FRAMEGOVERNOR_H
@@ -0,0 +1,110 @@
+#ifndef PROJECT_BASE_GLRESOURCE_H
+#define PROJECT_BASE_GLRESOURCE_H
+
+#include <glad/glad.h>
+
+namespace rg {
+
+// Owns a single OpenGL object name and deletes it when destroyed. Move-only, so a GL object has
+// exactly one owner and copying a Mesh or a framebuffer can no longer duplicate (and later
+// double-delete) names. Converts implicitly to GLuint so it can be passed straight to GL calls.
+template<typename Traits>
+class GLHandle {
+    GLuint m_Name = 0;
+public:
+    GLHandle() = default;
+
+    explicit GLHandle(GLuint name)
+            : m_Name(name) {}
+
+    ~GLHandle() {
+        reset();
+    }
+
+    GLHandle(const GLHandle&) = delete;
+    GLHandle& operator=(const GLHandle&) = delete;
+
+    GLHandle(GLHandle&& other) noexcept
+            : m_Name(other.release()) {}
+
+    GLHandle& operator=(GLHandle&& other) noexcept {
+        if (this != &other) {
+            reset(other.release());
+        }
+        return *this;
+    }
+
+    // generates a new object of this kind
+    static GLHandle create() {
+        return GLHandle(Traits::create());
+    }
+
+    GLuint get() const {
+        return m_Name;
+    }
+
+    operator GLuint() const {
+        return m_Name;
+    }
+
+    // gives up ownership without deleting the object
+    GLuint release() {
+        GLuint name = m_Name;
+        m_Name = 0;
+        return name;
+    }
+
+    void reset(GLuint name = 0) {
+        if (m_Name != 0) {
+            Traits::destroy(m_Name);
+        }
+        m_Name = name;
+    }
+};
+
+struct BufferTraits {
+    static GLuint create() { GLuint name; glGenBuffers(1, &name); return name; }
+    static void destroy(GLuint name) { glDeleteBuffers(1, &name); }
+};
+
+struct VertexArrayTraits {
+    static GLuint create() { GLuint name; glGenVertexArrays(1, &name); return name; }
+    static void destroy(GLuint name) { glDeleteVertexArrays(1, &name); }
+};
+
+struct TextureTraits {
+    static GLuint create() { GLuint name; glGenTextures(1, &name); return name; }
+    static void destroy(GLuint name) { glDeleteTextures(1, &name); }
+};
+
+struct FramebufferTraits {
+    static GLuint create() { GLuint name; glGenFramebuffers(1, &name); return name; }
+    static void destroy(GLuint name) { glDeleteFramebuffers(1, &name); }
+};
+
+struct RenderbufferTraits {
+    static GLuint create() { GLuint name; glGenRenderbuffers(1, &name); return name; }
+    static void destroy(GLuint name) { glDeleteRenderbuffers(1, &name); }
+};
+
+struct QueryTraits {
+    static GLuint create() { GLuint name; glGenQueries(1, &name); return name; }
+    static void destroy(GLuint name) { glDeleteQueries(1, &name); }
+};
+
+struct ProgramTraits {
+    static GLuint create() { return glCreateProgram(); }
+    static void destroy(GLuint name) { glDeleteProgram(name); }
+};
+
+using GLBuffer = GLHandle<BufferTraits>;
+using GLVertexArray = GLHandle<VertexArrayTraits>;
+using GLTexture = GLHandle<TextureTraits>;
+using GLFramebuffer = GLHandle<FramebufferTraits>;
+using GLRenderbuffer = GLHandle<RenderbufferTraits>;
+using GLQuery = GLHandle<QueryTraits>;
+using GLProgram = GLHandle<ProgramTraits>;
+
+}
+
+#endif //PROJECT_BASE_GLRESOURCE_H
@@ -0,0 +1,91 @@
+#ifndef PROJECT_BASE_GPUTIMER_H
+#define PROJECT_BASE_GPUTIMER_H
+
+#include <glad/glad.h>
+
+#include <rg/GLResource.h>
+
+namespace rg {
+
+// Measures how long the GPU spends on the commands between Begin and End with GL_TIME_ELAPSED queries
+// (core since 3.3). A result only arrives a frame or two later, so the timer cycles through
+// QUERY_COUNT queries and Collect returns whatever finished without waiting for the rest. A frame that
+// finds its query still in flight goes unmeasured instead of stalling. Only one timer can run at a time.
+class GpuTimer {
+public:
+    static const int QUERY_COUNT = 4;
+
+    GpuTimer() {
+        for (Query& query : m_Queries) {
+            query.name = GLQuery::create();
+        }
+    }
+
+    void Begin() {
+        Query& query = m_Queries[m_Next];
+        if (query.pending) {
+            collect(query);
+        }
+        m_Running = !query.pending;
+        if (m_Running) {
+            glBeginQuery(GL_TIME_ELAPSED, query.name);
+        }
+    }
+
+    void End() {
+        if (!m_Running) {
+            return;
+        }
+        glEndQuery(GL_TIME_ELAPSED);
+        m_Queries[m_Next].pending = true;
+        m_Next = (m_Next + 1) % QUERY_COUNT;
+        m_Running = false;
+    }
+
+    // The newest result that has come in since the last call, in milliseconds. Returns false while
+    // none has.
+    bool Collect(float& milliseconds) {
+        // oldest first, so the newest result is the one left in m_Result
+        for (int i = 0; i < QUERY_COUNT; ++i) {
+            Query& query = m_Queries[(m_Next + i) % QUERY_COUNT];
+            if (query.pending) {
+                collect(query);
+            }
+        }
+        if (!m_HasResult) {
+            return false;
+        }
+        milliseconds = m_Result;
+        m_HasResult = false;
+        return true;
+    }
+
+private:
+    struct Query {
+        GLQuery name;
+        bool pending = false;
+    };
+
+    Query m_Queries[QUERY_COUNT];
+    int m_Next = 0;
+    bool m_Running = false;
+    float m_Result = 0.0f;
+    bool m_HasResult = false;
+
+    void collect(Query& query) {
+        GLint available = 0;
+        glGetQueryObjectiv(query.name, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            return;
+        }
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(query.name, GL_QUERY_RESULT, &nanoseconds);
+        query.pending = false;
+        m_Result = static_cast<float>(nanoseconds / 1e6);
+        m_HasResult = true;
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_GPUTIMER_H
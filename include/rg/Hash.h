@@ -0,0 +1,34 @@
+#ifndef PROJECT_BASE_HASH_H
+#define PROJECT_BASE_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace rg {
+
+// 64-bit FNV-1a over 8-byte words, then the tail bytes; never 0, so 0 can mean "no hash"
+inline uint64_t hashBytes(const unsigned char* data, size_t size) {
+    const uint64_t prime = 0x100000001B3ull;
+    uint64_t hash = 0xCBF29CE484222325ull ^ size;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * prime;
+        hash ^= hash >> 29;
+    }
+    for (; i < size; ++i) {
+        hash = (hash ^ data[i]) * prime;
+    }
+    return hash != 0 ? hash : 1;
+}
+
+// order dependent combination of two hashes
+inline uint64_t combineHashes(uint64_t seed, uint64_t hash) {
+    return (seed ^ hash) * 0x100000001B3ull + 0x9E3779B97F4A7C15ull;
+}
+
+}
+
+#endif //PROJECT_BASE_HASH_H
@@ -0,0 +1,201 @@
+#ifndef PROJECT_BASE_IMAGE_H
+#define PROJECT_BASE_IMAGE_H
+
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include <rg/DDS.h>
+#include <rg/Hash.h>
+#include <rg/JpegDecoder.h>
+#include <rg/VirtualFileSystem.h>
+
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// S3TC and BPTC are extensions to the 3.3 core profile glad was generated for
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+// sRGB variants of S3TC come from EXT_texture_sRGB, which drivers exposing S3TC have as well
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM
+#define GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM 0x8E8D
+#endif
+
+namespace rg {
+
+// decoded 8-bit image, owns the pixels stb_image returned. When a baked .dds of the file exists and the
+// GPU can sample its format, compressed holds its mip chain instead and pixels stays empty.
+struct Image {
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    std::unique_ptr<unsigned char, void (*)(void*)> pixels{nullptr, stbi_image_free};
+    CompressedImage compressed;
+
+    explicit operator bool() const {
+        return pixels != nullptr || static_cast<bool>(compressed);
+    }
+};
+
+// bit (1 << BlockFormat) is set for every block format the context can sample
+inline std::atomic<unsigned int>& supportedBlockFormats() {
+    static std::atomic<unsigned int> formats{0};
+    return formats;
+}
+
+inline bool blockFormatSupported(BlockFormat format) {
+    return (supportedBlockFormats().load() >> static_cast<unsigned int>(format)) & 1u;
+}
+
+// Queries the compression extensions once on the GL thread, before any loading starts, so that workers
+// know whether a baked .dds is usable without touching GL themselves. Until it runs only the source
+// images are loaded.
+inline void detectBlockFormats() {
+    // RGTC is core since 3.0
+    unsigned int formats = 1u << static_cast<unsigned int>(BlockFormat::BC4) |
+                           1u << static_cast<unsigned int>(BlockFormat::BC5);
+    GLint extensionCount = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+    for (GLint i = 0; i < extensionCount; ++i) {
+        const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (std::strcmp(extension, "GL_EXT_texture_compression_s3tc") == 0) {
+            formats |= 1u << static_cast<unsigned int>(BlockFormat::BC1) |
+                       1u << static_cast<unsigned int>(BlockFormat::BC3);
+        } else if (std::strcmp(extension, "GL_ARB_texture_compression_bptc") == 0) {
+            formats |= 1u << static_cast<unsigned int>(BlockFormat::BC7);
+        }
+    }
+    supportedBlockFormats() = formats;
+}
+
+// The baked .dds of an image file if there is one the GPU can sample, an empty image otherwise. With the
+// source's sourceHash (hashBytes of its contents) a .dds baked from different contents counts as stale and
+// isn't used either; one that doesn't record its source, or a call without a hash, isn't checked.
+inline Image loadBakedImage(const std::string& path, uint64_t sourceHash = 0) {
+    Image image;
+    FileView file = VirtualFileSystem::Instance().Read(compressedPath(path));
+    if (!file) {
+        return image;
+    }
+    CompressedImage compressed = parseDDS(file.data, file.size);
+    if (compressed && sourceHash != 0 && compressed.sourceHash != 0 && compressed.sourceHash != sourceHash) {
+        std::cout << "Stale " << compressedPath(path) << ", decoding " << path << " instead" << std::endl;
+        return image;
+    }
+    if (compressed && blockFormatSupported(compressed.format)) {
+        image.width = compressed.width;
+        image.height = compressed.height;
+        image.channels = blockChannels(compressed.format);
+        image.compressed = std::move(compressed);
+    }
+    return image;
+}
+
+// decodes an image file already read into memory; JPEGs go to libjpeg-turbo when it was built in
+inline Image decodeImage(const unsigned char* data, size_t size) {
+    Image image;
+#ifdef RG_HAVE_LIBJPEG
+    if (isJpeg(data, size)) {
+        image.pixels.reset(decodeJpeg(data, size, &image.width, &image.height, &image.channels));
+        if (image.pixels) {
+            return image;
+        }
+    }
+#endif
+    image.pixels.reset(stbi_load_from_memory(data, static_cast<int>(size), &image.width, &image.height,
+                                             &image.channels, 0));
+    return image;
+}
+
+// decodes an image file, preferring its baked .dds unless that is stale; touches no GL state, so it is
+// safe on worker threads
+inline Image loadImage(const std::string& path) {
+    FileView file = VirtualFileSystem::Instance().Read(path);
+    Image image = loadBakedImage(path, file ? hashBytes(file.data, file.size) : 0);
+    if (!image && file) {
+        image = decodeImage(file.data, file.size);
+    }
+    return image;
+}
+
+// pixel format matching the number of channels of a decoded image
+inline GLenum imageFormat(int channels) {
+    switch (channels) {
+        case 1: return GL_RED;
+        case 2: return GL_RG;
+        case 4: return GL_RGBA;
+        default: return GL_RGB;
+    }
+}
+
+// Internal format for a decoded image. Color images (srgb) are stored as sRGB so that sampling returns
+// linear values; one and two channel images are always data.
+inline GLenum imageInternalFormat(int channels, bool srgb) {
+    if (srgb && channels == 3) {
+        return GL_SRGB8;
+    }
+    if (srgb && channels == 4) {
+        return GL_SRGB8_ALPHA8;
+    }
+    return imageFormat(channels);
+}
+
+// same for a block format; BC4 and BC5 have no sRGB variant
+inline GLenum compressedFormat(BlockFormat format, bool srgb = false) {
+    switch (format) {
+        case BlockFormat::BC1: return srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case BlockFormat::BC3: return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case BlockFormat::BC4: return GL_COMPRESSED_RED_RGTC1;
+        case BlockFormat::BC5: return GL_COMPRESSED_RG_RGTC2;
+        case BlockFormat::BC7: return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+    }
+    return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+}
+
+// Uploads the image into target (GL_TEXTURE_2D or a cube map face) of the bound texture: every baked mip
+// level of a compressed image, just the base level of a decoded one. srgb marks color images.
+inline void uploadImage(GLenum target, const Image& image, bool srgb = false) {
+    if (image.compressed) {
+        const CompressedImage& compressed = image.compressed;
+        for (size_t level = 0; level < compressed.levels.size(); ++level) {
+            const MipLevel& mip = compressed.levels[level];
+            glCompressedTexImage2D(target, static_cast<GLint>(level), compressedFormat(compressed.format, srgb),
+                                   mip.width, mip.height, 0, static_cast<GLsizei>(mip.size),
+                                   compressed.data.data() + mip.offset);
+        }
+    } else {
+        GLenum format = imageFormat(image.channels);
+        glTexImage2D(target, 0, imageInternalFormat(image.channels, srgb), image.width, image.height, 0, format,
+                     GL_UNSIGNED_BYTE, image.pixels.get());
+    }
+}
+
+// completes the mip chain of the texture bound to target after uploadImage: baked chains only need
+// their length set, decoded images get theirs generated
+inline void finishMipChain(GLenum target, const Image& image) {
+    if (image.compressed) {
+        glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(image.compressed.levels.size()) - 1);
+    } else {
+        glGenerateMipmap(target);
+    }
+}
+
+}
+
+#endif //PROJECT_BASE_IMAGE_H
@@ -0,0 +1,46 @@
+#ifndef PROJECT_BASE_IMAGEDECODER_H
+#define PROJECT_BASE_IMAGEDECODER_H
+
+#include <rg/Image.h>
+#include <rg/TextureCache.h>
+#include <rg/ThreadPool.h>
+
+#include <future>
+#include <string>
+#include <vector>
+
+namespace rg {
+
+// Image decoding job queue on top of the worker pool. Every file is its own job, so a batch (the six
+// cube map faces, a model's textures) decodes as wide as there are workers. Results come back as
+// futures that the GL thread picks up for upload; the pixel memory comes from the staging pool
+// (rg/StagingMemory.h) and returns to it when the Image is dropped after upload. Files go through the
+// texture cache, so anything already resident comes back without being decoded again.
+//
+// Don't wait on these futures from inside a pool job (use ThreadPool::ParallelFor there instead):
+// with every worker blocked nothing would be left to run the decodes.
+class ImageDecoder {
+public:
+    explicit ImageDecoder(ThreadPool& pool)
+            : m_Pool(pool) {}
+
+    std::future<TextureSource> Decode(const std::string& path, TextureVariant variant) {
+        return m_Pool.Submit([path, variant] { return TextureCache::Instance().Load(path, variant); });
+    }
+
+    std::vector<std::future<TextureSource>> Decode(const std::vector<std::string>& paths, TextureVariant variant) {
+        std::vector<std::future<TextureSource>> images;
+        images.reserve(paths.size());
+        for (const std::string& path : paths) {
+            images.push_back(Decode(path, variant));
+        }
+        return images;
+    }
+
+private:
+    ThreadPool& m_Pool;
+};
+
+}
+
+#endif //PROJECT_BASE_IMAGEDECODER_H
@@ -0,0 +1,97 @@
+#ifndef PROJECT_BASE_JPEGDECODER_H
+#define PROJECT_BASE_JPEGDECODER_H
+
+#include <rg/StagingMemory.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+
+// libjpeg-turbo is optional: CMake defines RG_HAVE_LIBJPEG and links it when find_package(JPEG) succeeds
+#ifdef RG_HAVE_LIBJPEG
+#include <csetjmp>
+#include <jpeglib.h>
+#endif
+
+namespace rg {
+
+inline bool isJpeg(const unsigned char* data, size_t size) {
+    return size >= 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF;
+}
+
+#ifdef RG_HAVE_LIBJPEG
+
+namespace jpeg {
+
+struct ErrorManager {
+    jpeg_error_mgr base;
+    std::jmp_buf jump;
+};
+
+// libjpeg reports fatal errors through error_exit and expects it not to return
+inline void errorExit(j_common_ptr info) {
+    std::longjmp(reinterpret_cast<ErrorManager*>(info->err)->jump, 1);
+}
+
+// corrupt-data warnings are as good as errors for an asset; stay quiet like stb does
+inline void outputMessage(j_common_ptr) {}
+
+}
+
+// Decodes a JPEG held in memory with libjpeg-turbo, whose IDCT, upsampling and color conversion run on
+// SIMD. Same output as stbi_load with 0 requested channels: 8-bit grayscale or RGB, rows top to bottom,
+// in staging memory so that stbi_image_free releases it. Returns nullptr for anything it can't decode
+// (CMYK files, corrupt data), which the caller hands to stb_image instead.
+inline unsigned char* decodeJpeg(const unsigned char* data, size_t size, int* width, int* height, int* channels) {
+    jpeg_decompress_struct info;
+    jpeg::ErrorManager error;
+    info.err = jpeg_std_error(&error.base);
+    error.base.error_exit = jpeg::errorExit;
+    error.base.output_message = jpeg::outputMessage;
+    // written after setjmp, so it has to live in memory
+    unsigned char* volatile pixels = nullptr;
+    if (setjmp(error.jump)) {
+        jpeg_destroy_decompress(&info);
+        staging::release(pixels);
+        return nullptr;
+    }
+
+    jpeg_create_decompress(&info);
+    jpeg_mem_src(&info, const_cast<unsigned char*>(data), static_cast<unsigned long>(size));
+    if (jpeg_read_header(&info, TRUE) != JPEG_HEADER_OK || info.jpeg_color_space == JCS_CMYK ||
+        info.jpeg_color_space == JCS_YCCK) {
+        jpeg_destroy_decompress(&info);
+        return nullptr;
+    }
+    info.out_color_space = info.num_components == 1 ? JCS_GRAYSCALE : JCS_RGB;
+    jpeg_start_decompress(&info);
+
+    size_t stride = static_cast<size_t>(info.output_width) * info.output_components;
+    pixels = static_cast<unsigned char*>(staging::allocate(stride * info.output_height));
+    if (!pixels) {
+        jpeg_destroy_decompress(&info);
+        return nullptr;
+    }
+    // a few rows per call lets the decoder work on whole MCU rows
+    JSAMPROW rows[16];
+    while (info.output_scanline < info.output_height) {
+        JDIMENSION count = std::min<JDIMENSION>(16, info.output_height - info.output_scanline);
+        for (JDIMENSION i = 0; i < count; ++i) {
+            rows[i] = pixels + (info.output_scanline + i) * stride;
+        }
+        jpeg_read_scanlines(&info, rows, count);
+    }
+    jpeg_finish_decompress(&info);
+
+    *width = static_cast<int>(info.output_width);
+    *height = static_cast<int>(info.output_height);
+    *channels = info.output_components;
+    jpeg_destroy_decompress(&info);
+    return pixels;
+}
+
+#endif
+
+}
+
+#endif //PROJECT_BASE_JPEGDECODER_H
@@ -0,0 +1,170 @@
+#ifndef PROJECT_BASE_LZ4_H
+#define PROJECT_BASE_LZ4_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace rg {
+
+// LZ4 block format (no frame header): the asset pack compresses entries with it. Compression is the
+// greedy single-hash-table search of LZ4's fast mode, decompression checks every length and offset
+// against both buffers, so a corrupt pack fails to decode instead of reading or writing out of bounds.
+namespace lz4 {
+
+const size_t MIN_MATCH = 4;
+const size_t LAST_LITERALS = 5;  // a block always ends with at least this many literals
+const size_t MATCH_FIND_LIMIT = 12; // and no match starts closer than this to its end
+const size_t MAX_OFFSET = 65535;
+const int HASH_BITS = 16;
+
+inline uint32_t read32(const unsigned char* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint32_t hash(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// lengths of 15 and more continue in bytes after the token, 255 meaning "more follows"
+inline void writeLength(std::vector<unsigned char>& out, size_t length) {
+    length -= 15;
+    for (; length >= 255; length -= 255) {
+        out.push_back(255);
+    }
+    out.push_back(static_cast<unsigned char>(length));
+}
+
+inline bool readLength(const unsigned char* src, size_t size, size_t& position, size_t& length) {
+    unsigned char byte;
+    do {
+        if (position >= size) {
+            return false;
+        }
+        byte = src[position++];
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+inline void writeSequence(std::vector<unsigned char>& out, const unsigned char* literals, size_t literalCount,
+                          size_t offset, size_t matchLength) {
+    size_t matchCode = matchLength - MIN_MATCH;
+    out.push_back(static_cast<unsigned char>(std::min<size_t>(literalCount, 15) << 4 | std::min<size_t>(matchCode, 15)));
+    if (literalCount >= 15) {
+        writeLength(out, literalCount);
+    }
+    out.insert(out.end(), literals, literals + literalCount);
+    out.push_back(static_cast<unsigned char>(offset & 0xFF));
+    out.push_back(static_cast<unsigned char>(offset >> 8));
+    if (matchCode >= 15) {
+        writeLength(out, matchCode);
+    }
+}
+
+}
+
+// worst case size of compressing size bytes (incompressible data grows a little)
+inline size_t lz4CompressBound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+inline std::vector<unsigned char> lz4Compress(const unsigned char* src, size_t size) {
+    std::vector<unsigned char> out;
+    out.reserve(lz4CompressBound(size));
+    size_t anchor = 0;
+    if (size > lz4::MATCH_FIND_LIMIT) {
+        std::vector<uint32_t> table(size_t(1) << lz4::HASH_BITS, 0);
+        size_t matchEnd = size - lz4::LAST_LITERALS;
+        size_t lastStart = size - lz4::MATCH_FIND_LIMIT;
+        size_t position = 0;
+        while (position <= lastStart) {
+            uint32_t sequence = lz4::read32(src + position);
+            uint32_t& slot = table[lz4::hash(sequence)];
+            size_t candidate = slot;
+            slot = static_cast<uint32_t>(position);
+            if (candidate >= position || position - candidate > lz4::MAX_OFFSET ||
+                lz4::read32(src + candidate) != sequence) {
+                // step faster through data that doesn't compress
+                position += 1 + ((position - anchor) >> 6);
+                continue;
+            }
+            while (position > anchor && candidate > 0 && src[position - 1] == src[candidate - 1]) {
+                --position;
+                --candidate;
+            }
+            size_t length = lz4::MIN_MATCH;
+            while (position + length < matchEnd && src[position + length] == src[candidate + length]) {
+                ++length;
+            }
+            lz4::writeSequence(out, src + anchor, position - anchor, position - candidate, length);
+            position += length;
+            anchor = position;
+        }
+    }
+    // the rest is literals, in a final sequence without a match
+    size_t literalCount = size - anchor;
+    out.push_back(static_cast<unsigned char>(std::min<size_t>(literalCount, 15) << 4));
+    if (literalCount >= 15) {
+        lz4::writeLength(out, literalCount);
+    }
+    out.insert(out.end(), src + anchor, src + size);
+    return out;
+}
+
+// decompresses a block into exactly dstSize bytes; false if the block is corrupt or doesn't fill dst
+inline bool lz4Decompress(const unsigned char* src, size_t srcSize, unsigned char* dst, size_t dstSize) {
+    size_t in = 0;
+    size_t out = 0;
+    while (in < srcSize) {
+        unsigned char token = src[in++];
+        size_t literalCount = token >> 4;
+        if (literalCount == 15 && !lz4::readLength(src, srcSize, in, literalCount)) {
+            return false;
+        }
+        if (literalCount > srcSize - in || literalCount > dstSize - out) {
+            return false;
+        }
+        if (literalCount > 0) {
+            std::memcpy(dst + out, src + in, literalCount);
+        }
+        in += literalCount;
+        out += literalCount;
+        if (in == srcSize) {
+            break;
+        }
+
+        if (srcSize - in < 2) {
+            return false;
+        }
+        size_t offset = src[in] | static_cast<size_t>(src[in + 1]) << 8;
+        in += 2;
+        size_t length = token & 15;
+        if (length == 15 && !lz4::readLength(src, srcSize, in, length)) {
+            return false;
+        }
+        length += lz4::MIN_MATCH;
+        if (offset == 0 || offset > out || length > dstSize - out) {
+            return false;
+        }
+        const unsigned char* match = dst + out - offset;
+        if (offset >= length) {
+            std::memcpy(dst + out, match, length);
+        } else {
+            // overlapping match repeats the last offset bytes
+            for (size_t i = 0; i < length; ++i) {
+                dst[out + i] = match[i];
+            }
+        }
+        out += length;
+    }
+    return out == dstSize;
+}
+
+}
+
+#endif //PROJECT_BASE_LZ4_H
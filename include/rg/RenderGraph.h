@@ -0,0 +1,384 @@
+#ifndef PROJECT_BASE_RENDERGRAPH_H
+#define PROJECT_BASE_RENDERGRAPH_H
+
+#include <glad/glad.h>
+
+#include <rg/GLResource.h>
+#include <rg/RenderTargets.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace rg {
+
+// size and internal format of a texture the graph allocates
+struct TextureDesc {
+    int width;
+    int height;
+    GLenum format;
+
+    bool operator==(const TextureDesc& other) const {
+        return width == other.width && height == other.height && format == other.format;
+    }
+};
+
+// A frame described as passes that declare the textures they read and write, rebuilt every frame.
+//
+// Compile works out what actually has to run. Passes are ordered so that every pass comes after the
+// writers of what it reads and several writers of one texture keep their declaration order. A read sees
+// the writes declared before it, or all of them if there are none yet, and a write declared after such a
+// read waits for it, so it can't overwrite that pass's input, aliased or not. Passes whose writes nothing
+// reads on the way to an output (MarkOutput) are culled. Transient textures
+// (CreateTexture) only exist between their first and last use, so those with the same size and format
+// whose uses don't overlap share one texture, and the textures live on in a pool from one frame to the
+// next, freed once a frame no longer asks for them.
+//
+// Before running a pass the graph binds the framebuffer of the first texture it writes that has one,
+// with a viewport covering it; external textures (ImportExternal), filled in by effects that keep their
+// own targets, don't.
+class RenderGraph {
+public:
+    typedef int Resource;
+    typedef std::function<void()> Execute;
+
+    // clears the passes and textures of the last frame; the pool's textures stay for reuse
+    void Reset() {
+        m_Resources.clear();
+        m_Passes.clear();
+        m_Order.clear();
+        for (Physical& physical : m_Pool) {
+            physical.used = false;
+        }
+    }
+
+    // the default framebuffer, width x height
+    Resource ImportWindow(int width, int height) {
+        return addResource("window", Kind::Imported, TextureDesc{width, height, GL_NONE}, 0, 0, true);
+    }
+
+    // a texture owned elsewhere, attached to framebuffer
+    Resource ImportTexture(const std::string& name, GLuint texture, GLuint framebuffer, int width, int height) {
+        return addResource(name, Kind::Imported, TextureDesc{width, height, GL_NONE}, texture, framebuffer, true);
+    }
+
+    // a texture only known once the pass writing it has run, which hands it over with SetTexture
+    Resource ImportExternal(const std::string& name) {
+        return addResource(name, Kind::Imported, TextureDesc{0, 0, GL_NONE}, 0, 0, false);
+    }
+
+    // a texture that lives for this frame only, allocated from the pool when Compile keeps a pass using it
+    Resource CreateTexture(const std::string& name, const TextureDesc& desc) {
+        return addResource(name, Kind::Transient, desc, 0, 0, true);
+    }
+
+    void SetTexture(Resource resource, GLuint texture) {
+        m_Resources[resource].texture = texture;
+    }
+
+    GLuint Texture(Resource resource) const {
+        return m_Resources[resource].texture;
+    }
+
+    const TextureDesc& Desc(Resource resource) const {
+        return m_Resources[resource].desc;
+    }
+
+    void AddPass(const std::string& name, std::vector<Resource> reads, std::vector<Resource> writes, Execute execute) {
+        m_Passes.push_back(Pass{name, std::move(reads), std::move(writes), std::move(execute), false});
+    }
+
+    // something outside the graph uses resource, so the passes writing it are kept
+    void MarkOutput(Resource resource) {
+        m_Resources[resource].output = true;
+    }
+
+    void Compile() {
+        sortPasses();
+        cullPasses();
+        allocateTransients();
+    }
+
+    // runs the passes Compile kept, in its order
+    void Run() {
+        for (int index : m_Order) {
+            const Pass& pass = m_Passes[index];
+            if (pass.culled) {
+                continue;
+            }
+            for (Resource write : pass.writes) {
+                const ResourceEntry& resource = m_Resources[write];
+                if (resource.hasFramebuffer) {
+                    glBindFramebuffer(GL_FRAMEBUFFER, resource.framebuffer);
+                    glViewport(0, 0, resource.desc.width, resource.desc.height);
+                    break;
+                }
+            }
+            pass.execute();
+        }
+        // what this frame didn't ask for isn't likely to be asked for again (a new window size, a
+        // pass switched off)
+        m_Pool.erase(std::remove_if(m_Pool.begin(), m_Pool.end(), [](const Physical& physical) {
+            return !physical.used;
+        }), m_Pool.end());
+    }
+
+    // for the stats overlay
+
+    struct PassInfo {
+        std::string name;
+        bool culled;
+    };
+
+    // in the order they run, the culled ones where they would have run
+    std::vector<PassInfo> Passes() const {
+        std::vector<PassInfo> passes;
+        for (int index : m_Order) {
+            passes.push_back(PassInfo{m_Passes[index].name, m_Passes[index].culled});
+        }
+        return passes;
+    }
+
+    // the transient textures the kept passes use, and the textures they were given
+    int TransientCount() const {
+        int count = 0;
+        for (const ResourceEntry& resource : m_Resources) {
+            count += resource.kind == Kind::Transient && resource.physical >= 0;
+        }
+        return count;
+    }
+
+    int AllocatedCount() const {
+        return static_cast<int>(m_Pool.size());
+    }
+
+    // bytes the transients would take each in a texture of its own, and what the pool holds
+    size_t TransientBytes() const {
+        size_t bytes = 0;
+        for (const ResourceEntry& resource : m_Resources) {
+            if (resource.kind == Kind::Transient && resource.physical >= 0) {
+                bytes += textureBytes(resource.desc);
+            }
+        }
+        return bytes;
+    }
+
+    size_t AllocatedBytes() const {
+        size_t bytes = 0;
+        for (const Physical& physical : m_Pool) {
+            bytes += textureBytes(physical.desc);
+        }
+        return bytes;
+    }
+
+private:
+    enum class Kind {
+        Imported,
+        Transient
+    };
+
+    struct ResourceEntry {
+        std::string name;
+        Kind kind;
+        TextureDesc desc;
+        GLuint texture;
+        GLuint framebuffer;
+        bool hasFramebuffer;
+        bool output;
+        int physical; // index into m_Pool, transients the kept passes use
+    };
+
+    struct Pass {
+        std::string name;
+        std::vector<Resource> reads;
+        std::vector<Resource> writes;
+        Execute execute;
+        bool culled;
+    };
+
+    // a pooled texture with the framebuffer it is attached to
+    struct Physical {
+        TextureDesc desc;
+        GLTexture texture;
+        GLFramebuffer framebuffer;
+        bool used; // by this frame
+        int freeAfter; // position in the order after which it can be handed out again this frame
+    };
+
+    std::vector<ResourceEntry> m_Resources;
+    std::vector<Pass> m_Passes;
+    std::vector<int> m_Order;
+    std::vector<Physical> m_Pool;
+    bool m_CycleReported = false; // the graph is rebuilt every frame, a cycle would be every frame too
+
+    static size_t textureBytes(const TextureDesc& desc) {
+        return static_cast<size_t>(desc.width) * desc.height * targetPixelSize(desc.format);
+    }
+
+    static bool contains(const std::vector<Resource>& resources, Resource resource) {
+        return std::find(resources.begin(), resources.end(), resource) != resources.end();
+    }
+
+    Resource addResource(const std::string& name, Kind kind, const TextureDesc& desc, GLuint texture,
+                         GLuint framebuffer, bool hasFramebuffer) {
+        m_Resources.push_back(ResourceEntry{name, kind, desc, texture, framebuffer, hasFramebuffer, false, -1});
+        return static_cast<Resource>(m_Resources.size() - 1);
+    }
+
+    // whether a pass declared before pass writes resource
+    bool writtenBefore(Resource resource, size_t pass) const {
+        for (size_t i = 0; i < pass; ++i) {
+            if (contains(m_Passes[i].writes, resource)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Stable topological sort. A pass that reads a texture depends on the writers of it declared before
+    // it, or on all of them when there are none yet; one that writes a texture depends on the writers of
+    // it declared before it, and on the passes declared before it that only read it after an earlier
+    // write (write after read). Falls back to the declaration order on a cycle, reported once.
+    void sortPasses() {
+        size_t count = m_Passes.size();
+        std::vector<std::vector<int>> dependents(count);
+        std::vector<int> dependencies(count, 0);
+        for (size_t i = 0; i < count; ++i) {
+            for (size_t j = 0; j < count; ++j) {
+                if (i == j) {
+                    continue;
+                }
+                bool depends = false;
+                for (Resource write : m_Passes[j].writes) {
+                    bool reads = contains(m_Passes[i].reads, write), writes = contains(m_Passes[i].writes, write);
+                    // read after write, and the declared order of writes
+                    depends = depends || (reads && !writes && (j < i || !writtenBefore(write, i))) ||
+                              ((reads || writes) && j < i);
+                }
+                // write after read: an earlier reader of an earlier write goes first
+                for (Resource read : m_Passes[j].reads) {
+                    depends = depends || (j < i && contains(m_Passes[i].writes, read) &&
+                                          !contains(m_Passes[j].writes, read) && writtenBefore(read, j));
+                }
+                if (depends) {
+                    dependents[j].push_back(static_cast<int>(i));
+                    ++dependencies[i];
+                }
+            }
+        }
+        m_Order.clear();
+        std::vector<bool> done(count, false);
+        while (m_Order.size() < count) {
+            // the first pass in declaration order that is ready
+            size_t next = 0;
+            while (next < count && (done[next] || dependencies[next] > 0)) {
+                ++next;
+            }
+            if (next == count) {
+                if (!m_CycleReported) {
+                    std::cout << "Render graph has a cycle, running the passes in declaration order" << std::endl;
+                    m_CycleReported = true;
+                }
+                m_Order.clear();
+                for (size_t i = 0; i < count; ++i) {
+                    m_Order.push_back(static_cast<int>(i));
+                }
+                return;
+            }
+            done[next] = true;
+            m_Order.push_back(static_cast<int>(next));
+            for (int dependent : dependents[next]) {
+                --dependencies[dependent];
+            }
+        }
+    }
+
+    // backwards through the order: a pass is kept if an output or a kept pass needs one of its writes
+    void cullPasses() {
+        std::vector<bool> needed(m_Resources.size(), false);
+        for (size_t i = 0; i < m_Resources.size(); ++i) {
+            needed[i] = m_Resources[i].output;
+        }
+        for (auto it = m_Order.rbegin(); it != m_Order.rend(); ++it) {
+            Pass& pass = m_Passes[*it];
+            pass.culled = true;
+            for (Resource write : pass.writes) {
+                pass.culled = pass.culled && !needed[write];
+            }
+            if (!pass.culled) {
+                for (Resource read : pass.reads) {
+                    needed[read] = true;
+                }
+            }
+        }
+    }
+
+    // Hands each transient a pooled texture of its size and format at its first use, which goes back
+    // to the pool after its last, so transients whose uses don't overlap share one.
+    void allocateTransients() {
+        std::vector<int> first(m_Resources.size(), -1), last(m_Resources.size(), -1);
+        for (size_t position = 0; position < m_Order.size(); ++position) {
+            const Pass& pass = m_Passes[m_Order[position]];
+            if (pass.culled) {
+                continue;
+            }
+            for (const std::vector<Resource>* resources : {&pass.reads, &pass.writes}) {
+                for (Resource resource : *resources) {
+                    if (first[resource] < 0) {
+                        first[resource] = static_cast<int>(position);
+                    }
+                    last[resource] = static_cast<int>(position);
+                }
+            }
+        }
+        for (Physical& physical : m_Pool) {
+            physical.freeAfter = -1;
+        }
+        for (size_t position = 0; position < m_Order.size(); ++position) {
+            for (size_t i = 0; i < m_Resources.size(); ++i) {
+                ResourceEntry& resource = m_Resources[i];
+                if (resource.kind != Kind::Transient || first[i] != static_cast<int>(position)) {
+                    continue;
+                }
+                int physical = acquire(resource.desc, static_cast<int>(position));
+                m_Pool[physical].freeAfter = last[i];
+                resource.physical = physical;
+                resource.texture = m_Pool[physical].texture;
+                resource.framebuffer = m_Pool[physical].framebuffer;
+            }
+        }
+    }
+
+    int acquire(const TextureDesc& desc, int position) {
+        for (size_t i = 0; i < m_Pool.size(); ++i) {
+            Physical& physical = m_Pool[i];
+            if (physical.desc == desc && physical.freeAfter < position) {
+                physical.used = true;
+                return static_cast<int>(i);
+            }
+        }
+        Physical physical{desc, GLTexture::create(), GLFramebuffer::create(), true, -1};
+        GLint framebuffer;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+        glBindTexture(GL_TEXTURE_2D, physical.texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, desc.format, desc.width, desc.height, 0, targetPixelFormat(desc.format),
+                     GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindFramebuffer(GL_FRAMEBUFFER, physical.framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, physical.texture, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        m_Pool.push_back(std::move(physical));
+        return static_cast<int>(m_Pool.size() - 1);
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_RENDERGRAPH_H
@@ -0,0 +1,254 @@
+#ifndef PROJECT_BASE_RENDERQUEUE_H
+#define PROJECT_BASE_RENDERQUEUE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader.h>
+#include <learnopengl/model.h>
+#include <rg/TextureResidency.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace rg {
+
+// layers are drawn in this order; each one has its own fixed-function state
+enum class RenderLayer : uint64_t {
+    Opaque = 0,      // front-to-back, depth test + back-face culling
+    Background = 1,  // skybox, drawn behind everything with GL_LEQUAL
+    Transparent = 2  // back-to-front, blended, no culling
+};
+
+struct DrawItem {
+    uint64_t key;
+    Shader* shader;
+    Mesh* mesh;                 // model mesh, or nullptr for a plain vertex array
+    unsigned int vao;           // plain vertex array drawn with glDrawArrays(GL_TRIANGLES, 0, count)
+    GLsizei count;
+    unsigned int texture;       // plain vertex arrays bind this to unit 0
+    GLenum textureTarget;
+    glm::mat4 model;
+    bool hasModel;              // the skybox has no model matrix
+    glm::vec3 color;            // optional "lightColor"
+    bool hasColor;
+};
+
+// Collects the frame's draws and replays them sorted by a 64-bit key so that opaque geometry goes
+// front-to-back (early-Z), draws sharing a program and texture set are adjacent, and blended
+// geometry goes back-to-front.
+//
+// key layout, most significant bits first:
+//   opaque/background: layer:2 | program:8 | material:16 | depth:24 | sequence:14
+//   transparent:       layer:2 | ~depth:24 | program:8 | material:16 | sequence:14
+class RenderQueue {
+public:
+    // per-frame camera data used to compute the depth part of the keys
+    void Begin(const glm::vec3& viewPosition, float farPlane)
+    {
+        items.clear();
+        this->viewPosition = viewPosition;
+        this->farPlane = farPlane;
+    }
+
+    // models submitted from now on report their on-screen size to residency (nullptr to stop)
+    void SetResidency(TextureResidency* residency)
+    {
+        this->residency = residency;
+    }
+
+    // every mesh of the model becomes its own item so meshes are grouped by texture set
+    void Submit(Model& model, Shader& shader, const glm::mat4& transform,
+                RenderLayer layer = RenderLayer::Opaque)
+    {
+        if (residency)
+            requestTextures(model, transform);
+        for (Mesh& mesh : model.meshes) {
+            DrawItem item = makeItem(shader, transform, layer);
+            item.mesh = &mesh;
+            item.key = makeKey(layer, shader.ID, materialKey(mesh), transform);
+            items.push_back(item);
+        }
+    }
+
+    void Submit(unsigned int vao, GLsizei count, unsigned int texture, GLenum textureTarget,
+                Shader& shader, const glm::mat4& transform, RenderLayer layer = RenderLayer::Opaque)
+    {
+        DrawItem item = makeItem(shader, transform, layer);
+        item.vao = vao;
+        item.count = count;
+        item.texture = texture;
+        item.textureTarget = textureTarget;
+        item.key = makeKey(layer, shader.ID, texture, transform);
+        items.push_back(item);
+    }
+
+    // same as above, additionally sets the "lightColor" uniform
+    void Submit(unsigned int vao, GLsizei count, Shader& shader, const glm::mat4& transform,
+                const glm::vec3& color, RenderLayer layer = RenderLayer::Opaque)
+    {
+        Submit(vao, count, 0, GL_TEXTURE_2D, shader, transform, layer);
+        items.back().color = color;
+        items.back().hasColor = true;
+    }
+
+    // skybox: no model matrix, sorted behind the opaque layer
+    void SubmitBackground(unsigned int vao, GLsizei count, unsigned int texture, GLenum textureTarget,
+                          Shader& shader)
+    {
+        Submit(vao, count, texture, textureTarget, shader, glm::mat4(1.0f), RenderLayer::Background);
+        items.back().hasModel = false;
+    }
+
+    // sorts the items and draws them, changing program, textures and layer state only when they differ
+    // from the previous item. Per-frame uniforms (view, projection, lights) must already be set.
+    void Flush()
+    {
+        std::sort(items.begin(), items.end(), [](const DrawItem& a, const DrawItem& b) {
+            return a.key < b.key;
+        });
+
+        unsigned int currentProgram = 0;
+        int currentLayer = -1;
+        unsigned int boundTextures[MAX_UNITS] = {0};
+
+        for (const DrawItem& item : items) {
+            int layer = static_cast<int>(item.key >> 62);
+            if (layer != currentLayer) {
+                applyLayerState(static_cast<RenderLayer>(layer));
+                currentLayer = layer;
+            }
+            if (item.shader->ID != currentProgram) {
+                item.shader->use();
+                currentProgram = item.shader->ID;
+            }
+            if (item.hasModel)
+                item.shader->setMat4("model", item.model);
+            if (item.hasColor)
+                item.shader->setVec3("lightColor", item.color);
+
+            if (item.mesh) {
+                for (const MaterialBinding& binding : item.mesh->Material(*item.shader)) {
+                    glUniform1i(binding.location, binding.unit);
+                    bindTexture(boundTextures, binding.unit, GL_TEXTURE_2D, binding.texture);
+                }
+                item.mesh->DrawGeometry();
+            } else {
+                if (item.texture != 0)
+                    bindTexture(boundTextures, 0, item.textureTarget, item.texture);
+                glBindVertexArray(item.vao);
+                glDrawArrays(GL_TRIANGLES, 0, item.count);
+            }
+        }
+
+        glBindVertexArray(0);
+        glActiveTexture(GL_TEXTURE0);
+        applyLayerState(RenderLayer::Opaque);
+    }
+
+    size_t Size() const
+    {
+        return items.size();
+    }
+
+private:
+    static const int MAX_UNITS = 16;
+
+    std::vector<DrawItem> items;
+    glm::vec3 viewPosition = glm::vec3(0.0f);
+    float farPlane = 100.0f;
+    TextureResidency* residency = nullptr;
+
+    DrawItem makeItem(Shader& shader, const glm::mat4& transform, RenderLayer layer) const
+    {
+        DrawItem item;
+        item.key = 0;
+        item.shader = &shader;
+        item.mesh = nullptr;
+        item.vao = 0;
+        item.count = 0;
+        item.texture = 0;
+        item.textureTarget = GL_TEXTURE_2D;
+        item.model = transform;
+        item.hasModel = true;
+        item.color = glm::vec3(0.0f);
+        item.hasColor = false;
+        return item;
+    }
+
+    void requestTextures(const Model& model, const glm::mat4& transform) const
+    {
+        glm::vec3 center = glm::vec3(transform * glm::vec4(model.boundsCenter, 1.0f));
+        float scale = std::max(std::max(glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1]))),
+                               glm::length(glm::vec3(transform[2])));
+        float screenSize = residency->ScreenSize(center, model.boundsRadius * scale);
+        for (const Mesh& mesh : model.meshes)
+            for (const Texture& texture : mesh.textures)
+                residency->Request(texture.id, screenSize);
+    }
+
+    // meshes are grouped by their first texture, which is the diffuse map for every model we load
+    static unsigned int materialKey(const Mesh& mesh)
+    {
+        return mesh.textures.empty() ? 0 : mesh.textures[0].id;
+    }
+
+    uint64_t makeKey(RenderLayer layer, unsigned int program, unsigned int material,
+                     const glm::mat4& transform) const
+    {
+        // distance of the object's origin from the camera, quantized to 24 bits
+        float distance = glm::length(glm::vec3(transform[3]) - viewPosition) / farPlane;
+        distance = std::min(std::max(distance, 0.0f), 1.0f);
+        uint64_t depth = static_cast<uint64_t>(distance * 0xFFFFFF);
+        uint64_t sequence = items.size() & 0x3FFF;
+        uint64_t programBits = program & 0xFF;
+        uint64_t materialBits = material & 0xFFFF;
+
+        uint64_t key = static_cast<uint64_t>(layer) << 62;
+        if (layer == RenderLayer::Transparent) {
+            key |= (0xFFFFFF - depth) << 38;
+            key |= programBits << 30;
+            key |= materialBits << 14;
+        } else {
+            key |= programBits << 54;
+            key |= materialBits << 38;
+            key |= depth << 14;
+        }
+        return key | sequence;
+    }
+
+    static void bindTexture(unsigned int* boundTextures, GLint unit, GLenum target, unsigned int texture)
+    {
+        if (unit < MAX_UNITS && boundTextures[unit] == texture)
+            return;
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(target, texture);
+        if (unit < MAX_UNITS)
+            boundTextures[unit] = texture;
+    }
+
+    static void applyLayerState(RenderLayer layer)
+    {
+        switch (layer) {
+            case RenderLayer::Opaque:
+                glEnable(GL_CULL_FACE);
+                glDepthFunc(GL_LESS);
+                glBlendFunc(GL_ONE, GL_ZERO);
+                break;
+            case RenderLayer::Background:
+                // depth test passes when values are equal to depth buffer's content
+                glDepthFunc(GL_LEQUAL);
+                break;
+            case RenderLayer::Transparent:
+                glDisable(GL_CULL_FACE);
+                glDepthFunc(GL_LESS);
+                glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+                break;
+        }
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_RENDERQUEUE_H
@@ -0,0 +1,242 @@
+#ifndef PROJECT_BASE_RENDERTARGETS_H
+#define PROJECT_BASE_RENDERTARGETS_H
+
+#include <glad/glad.h>
+
+#include <rg/GLResource.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+
+namespace rg {
+
+// Formats of the scene and bloom targets, to be picked per hardware tier. The scene never needs an
+// alpha channel, so the packed float format holds the same HDR colors, with a little less precision,
+// in half the bytes.
+enum class FormatProfile : int {
+    Quality,   // RGBA16F color, 32-bit float depth
+    Balanced,  // R11F_G11F_B10F color, 24-bit depth
+    Bandwidth  // as Balanced, with the bloom starting from half the scene's resolution
+};
+
+struct TargetFormats {
+    GLenum color;
+    GLenum depth;
+    bool halfResolutionBloom;
+};
+
+inline TargetFormats targetFormats(FormatProfile profile) {
+    switch (profile) {
+        case FormatProfile::Quality:
+            return TargetFormats{GL_RGBA16F, GL_DEPTH_COMPONENT32F, false};
+        case FormatProfile::Balanced:
+            return TargetFormats{GL_R11F_G11F_B10F, GL_DEPTH_COMPONENT24, false};
+        case FormatProfile::Bandwidth:
+        default:
+            return TargetFormats{GL_R11F_G11F_B10F, GL_DEPTH_COMPONENT24, true};
+    }
+}
+
+// bytes per pixel of the target formats above; 24-bit depth is padded to 32 bits by every driver
+inline size_t targetPixelSize(GLenum format) {
+    return format == GL_RGBA16F ? 8 : 4;
+}
+
+// the pixel transfer format to allocate a color target of format with
+inline GLenum targetPixelFormat(GLenum format) {
+    return format == GL_R11F_G11F_B10F ? GL_RGB : GL_RGBA;
+}
+
+const float MIN_RENDER_SCALE = 0.25f;
+const float MAX_RENDER_SCALE = 2.0f;
+// seconds the wanted size has to stay the same before the targets are reallocated
+const double RESIZE_DELAY = 0.2;
+
+// Owns the HDR scene framebuffer: its floating point color buffer and depth renderbuffer, sized to the
+// window's framebuffer times the render scale. The window size is known at once, for the composite's
+// viewport and the projection's aspect ratio, but the targets only follow once the size has settled
+// for RESIZE_DELAY, so dragging a window edge or the render scale slider doesn't reallocate every
+// frame. Until then the composite stretches the old image over the window, which the filtering hides.
+// A change of formats (SetFormats) is applied on the next Update without waiting.
+class RenderTargets {
+public:
+    // allocates the targets for a window framebuffer of width x height right away, in the formats of the
+    // profile the first frame uses, so they don't have to be reallocated for it
+    RenderTargets(int width, int height, const TargetFormats& formats)
+            : m_ColorFormat(formats.color), m_DepthFormat(formats.depth) {
+        SetWindowSize(width, height);
+        allocate(scaled(m_WindowWidth), scaled(m_WindowHeight));
+    }
+
+    // the window's framebuffer size in pixels, larger than the window size on high DPI displays;
+    // a minimized window (0 x 0) keeps the previous size
+    void SetWindowSize(int width, int height) {
+        if (width > 0 && height > 0) {
+            m_WindowWidth = width;
+            m_WindowHeight = height;
+        }
+    }
+
+    // scene resolution relative to the window, MIN_RENDER_SCALE to MAX_RENDER_SCALE
+    void SetRenderScale(float scale) {
+        m_RenderScale = std::max(MIN_RENDER_SCALE, std::min(scale, MAX_RENDER_SCALE));
+    }
+
+    float RenderScale() const {
+        return m_RenderScale;
+    }
+
+    // internal formats of the color buffer and the depth renderbuffer
+    void SetFormats(GLenum color, GLenum depth) {
+        if (color != m_ColorFormat || depth != m_DepthFormat) {
+            m_ColorFormat = color;
+            m_DepthFormat = depth;
+            m_FormatsChanged = true;
+        }
+    }
+
+    // Estimate of the bytes the scene pass moves at width x height with these formats: every color
+    // pixel written once and read twice (bloom, composite), depth tested and written once, ignoring
+    // overdraw, compression and caches. Good for comparing formats, not for absolute numbers.
+    static size_t EstimateFrameBytes(GLenum color, GLenum depth, int width, int height) {
+        size_t pixels = static_cast<size_t>(width) * height;
+        return pixels * (3 * targetPixelSize(color) + 2 * targetPixelSize(depth));
+    }
+
+    size_t FrameBytes() const {
+        return EstimateFrameBytes(m_ColorFormat, m_DepthFormat, m_Width, m_Height);
+    }
+
+    // Reallocates the targets once the wanted size has stayed the same for RESIZE_DELAY seconds; now
+    // is glfwGetTime(). Returns whether it did, after which the old texture names are gone.
+    bool Update(double now) {
+        int width = scaled(m_WindowWidth), height = scaled(m_WindowHeight);
+        if (m_FormatsChanged) {
+            allocate(m_Width, m_Height);
+            return true;
+        }
+        if (width == m_Width && height == m_Height) {
+            m_WantedWidth = width;
+            m_WantedHeight = height;
+            return false;
+        }
+        if (width != m_WantedWidth || height != m_WantedHeight) {
+            m_WantedWidth = width;
+            m_WantedHeight = height;
+            m_WantedSince = now;
+        }
+        if (now - m_WantedSince < RESIZE_DELAY) {
+            return false;
+        }
+        allocate(width, height);
+        return true;
+    }
+
+    // binds the scene framebuffer with a viewport covering it
+    void Bind() const {
+        glBindFramebuffer(GL_FRAMEBUFFER, m_Framebuffer);
+        glViewport(0, 0, m_Width, m_Height);
+    }
+
+    // binds the window's framebuffer with a viewport covering it
+    void BindWindow() const {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, m_WindowWidth, m_WindowHeight);
+    }
+
+    GLuint Framebuffer() const {
+        return m_Framebuffer;
+    }
+
+    GLuint ColorBuffer() const {
+        return m_ColorBuffer;
+    }
+
+    // size of the scene targets
+    int Width() const {
+        return m_Width;
+    }
+
+    int Height() const {
+        return m_Height;
+    }
+
+    int WindowWidth() const {
+        return m_WindowWidth;
+    }
+
+    int WindowHeight() const {
+        return m_WindowHeight;
+    }
+
+    // for the projection: the scene ends up covering the window, whatever size it is rendered at
+    float Aspect() const {
+        return static_cast<float>(m_WindowWidth) / static_cast<float>(m_WindowHeight);
+    }
+
+private:
+    GLFramebuffer m_Framebuffer = GLFramebuffer::create();
+    GLTexture m_ColorBuffer;
+    GLRenderbuffer m_DepthBuffer;
+    GLenum m_ColorFormat;
+    GLenum m_DepthFormat;
+    bool m_FormatsChanged = false;
+    int m_WindowWidth = 1;
+    int m_WindowHeight = 1;
+    float m_RenderScale = 1.0f;
+    int m_Width = 0;
+    int m_Height = 0;
+    int m_WantedWidth = 0;
+    int m_WantedHeight = 0;
+    double m_WantedSince = 0.0;
+
+    // the render scale, lowered as far as the larger side needs to fit GL_MAX_RENDERBUFFER_SIZE; one factor
+    // for both sides, so the scene keeps the window's aspect ratio
+    float scale() const {
+        GLint maxSize = 0;
+        glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxSize);
+        int largest = std::max(m_WindowWidth, m_WindowHeight);
+        return maxSize > 0 ? std::min(m_RenderScale, static_cast<float>(maxSize) / largest) : m_RenderScale;
+    }
+
+    int scaled(int size) const {
+        return std::max(1, static_cast<int>(std::lround(size * scale())));
+    }
+
+    void allocate(int width, int height) {
+        m_Width = m_WantedWidth = width;
+        m_Height = m_WantedHeight = height;
+        m_FormatsChanged = false;
+        GLint framebuffer;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, m_Framebuffer);
+
+        // new names rather than new storage for the old ones, so the driver can drop the old memory
+        // as soon as the frames in flight are done with it
+        m_ColorBuffer = GLTexture::create();
+        glBindTexture(GL_TEXTURE_2D, m_ColorBuffer);
+        glTexImage2D(GL_TEXTURE_2D, 0, m_ColorFormat, width, height, 0, targetPixelFormat(m_ColorFormat), GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        // clamped, as the bloom filters would otherwise sample repeated texture values
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_ColorBuffer, 0);
+
+        m_DepthBuffer = GLRenderbuffer::create();
+        glBindRenderbuffer(GL_RENDERBUFFER, m_DepthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, m_DepthFormat, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_DepthBuffer);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "Framebuffer not complete!" << std::endl;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_RENDERTARGETS_H
@@ -0,0 +1,137 @@
+#ifndef PROJECT_BASE_STAGINGMEMORY_H
+#define PROJECT_BASE_STAGINGMEMORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace rg {
+
+// Recycles the large buffers image decoding goes through. stb_image allocates through these functions
+// (STBI_MALLOC/STBI_REALLOC/STBI_FREE in libs/stb_image.cpp), so once a decoded image has been uploaded
+// and freed its pixel buffer goes back to a free list and the next decode of a similar size reuses it
+// instead of hitting malloc and page faults again.
+//
+// Blocks of at least MIN_POOLED bytes are rounded up to a power of two; smaller ones go straight to malloc.
+namespace staging {
+
+const size_t MIN_POOLED = 64 * 1024;
+const int SIZE_CLASSES = 16;                      // 64 KiB ... 2 GiB
+const size_t MAX_RETAINED = 128 * 1024 * 1024;    // free memory kept around for reuse
+const uint32_t UNPOOLED = 0xFFFFFFFF;
+
+struct BlockHeader {
+    uint32_t sizeClass;
+    uint32_t reserved;
+    uint64_t capacity;
+};
+static_assert(sizeof(BlockHeader) == 16, "block header must keep the payload 16-byte aligned");
+
+struct Pool {
+    std::mutex mutex;
+    std::vector<BlockHeader*> freeBlocks[SIZE_CLASSES];
+    size_t retainedBytes = 0;
+};
+
+inline Pool& pool() {
+    static Pool instance;
+    return instance;
+}
+
+inline int sizeClassFor(size_t size) {
+    size_t capacity = MIN_POOLED;
+    for (int sizeClass = 0; sizeClass < SIZE_CLASSES; ++sizeClass, capacity <<= 1) {
+        if (size <= capacity) {
+            return sizeClass;
+        }
+    }
+    return -1;
+}
+
+inline void* allocate(size_t size) {
+    int sizeClass = size >= MIN_POOLED ? sizeClassFor(size) : -1;
+    if (sizeClass < 0) {
+        BlockHeader* block = static_cast<BlockHeader*>(std::malloc(sizeof(BlockHeader) + size));
+        if (!block) {
+            return nullptr;
+        }
+        block->sizeClass = UNPOOLED;
+        block->capacity = size;
+        return block + 1;
+    }
+
+    Pool& p = pool();
+    {
+        std::lock_guard<std::mutex> lock(p.mutex);
+        std::vector<BlockHeader*>& blocks = p.freeBlocks[sizeClass];
+        if (!blocks.empty()) {
+            BlockHeader* block = blocks.back();
+            blocks.pop_back();
+            p.retainedBytes -= block->capacity;
+            return block + 1;
+        }
+    }
+    size_t capacity = MIN_POOLED << sizeClass;
+    BlockHeader* block = static_cast<BlockHeader*>(std::malloc(sizeof(BlockHeader) + capacity));
+    if (!block) {
+        return nullptr;
+    }
+    block->sizeClass = static_cast<uint32_t>(sizeClass);
+    block->capacity = capacity;
+    return block + 1;
+}
+
+inline void release(void* memory) {
+    if (!memory) {
+        return;
+    }
+    BlockHeader* block = static_cast<BlockHeader*>(memory) - 1;
+    if (block->sizeClass != UNPOOLED) {
+        Pool& p = pool();
+        std::lock_guard<std::mutex> lock(p.mutex);
+        if (p.retainedBytes + block->capacity <= MAX_RETAINED) {
+            p.freeBlocks[block->sizeClass].push_back(block);
+            p.retainedBytes += block->capacity;
+            return;
+        }
+    }
+    std::free(block);
+}
+
+inline void* reallocate(void* memory, size_t size) {
+    if (!memory) {
+        return allocate(size);
+    }
+    BlockHeader* block = static_cast<BlockHeader*>(memory) - 1;
+    if (size <= block->capacity && (block->sizeClass != UNPOOLED || size >= block->capacity / 2)) {
+        return memory;
+    }
+    void* grown = allocate(size);
+    if (grown) {
+        std::memcpy(grown, memory, block->capacity < size ? block->capacity : size);
+        release(memory);
+    }
+    return grown;
+}
+
+// drops every retained block, e.g. once loading is finished
+inline void trim() {
+    Pool& p = pool();
+    std::lock_guard<std::mutex> lock(p.mutex);
+    for (std::vector<BlockHeader*>& blocks : p.freeBlocks) {
+        for (BlockHeader* block : blocks) {
+            std::free(block);
+        }
+        blocks.clear();
+    }
+    p.retainedBytes = 0;
+}
+
+}
+
+}
+
+#endif //PROJECT_BASE_STAGINGMEMORY_H
@@ -0,0 +1,310 @@
+#ifndef PROJECT_BASE_TEXTURECACHE_H
+#define PROJECT_BASE_TEXTURECACHE_H
+
+#include <glad/glad.h>
+
+#include <rg/Hash.h>
+#include <rg/Image.h>
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace rg {
+
+// Textures made from the same file but with different sampling state are cached separately.
+enum class TextureVariant : uint64_t {
+    Material = 0,      // mipmapped, repeating model texture holding data (specular, normal maps)
+    Sprite = 1,        // billboard texture, clamped to the edge when it has alpha
+    CubeFace = 2,      // face of a cube map, cached as part of the whole cube map
+    MaterialColor = 3  // same as Material, but a color map stored as sRGB
+};
+
+// Result of looking a file up in the cache on a worker: the content key and, unless a texture with that
+// content was already resident, the decoded image.
+struct TextureSource {
+    std::string path;                    // canonical path
+    uint64_t key = 0;                    // content hash mixed with the variant, 0 if the file can't be read
+    uint64_t content = 0;                // content hash alone
+    std::shared_ptr<const Image> image;
+
+    explicit operator bool() const {
+        return key != 0;
+    }
+};
+
+// Reference to a cached GL texture; the texture is deleted when the last reference goes away. Move-only,
+// converts to GLuint like the handles in rg/GLResource.h. Must be destroyed on the GL thread.
+class CachedTexture {
+public:
+    CachedTexture() = default;
+
+    ~CachedTexture() {
+        reset();
+    }
+
+    CachedTexture(const CachedTexture&) = delete;
+    CachedTexture& operator=(const CachedTexture&) = delete;
+
+    CachedTexture(CachedTexture&& other) noexcept
+            : m_Key(other.m_Key), m_Name(other.m_Name) {
+        other.m_Key = 0;
+        other.m_Name = 0;
+    }
+
+    CachedTexture& operator=(CachedTexture&& other) noexcept {
+        if (this != &other) {
+            reset();
+            m_Key = other.m_Key;
+            m_Name = other.m_Name;
+            other.m_Key = 0;
+            other.m_Name = 0;
+        }
+        return *this;
+    }
+
+    GLuint get() const {
+        return m_Name;
+    }
+
+    operator GLuint() const {
+        return m_Name;
+    }
+
+    explicit operator bool() const {
+        return m_Name != 0;
+    }
+
+    inline void reset();
+
+private:
+    friend class TextureCache;
+    uint64_t m_Key = 0;
+    GLuint m_Name = 0;
+
+    CachedTexture(uint64_t key, GLuint name)
+            : m_Key(key), m_Name(name) {}
+};
+
+// Process-wide texture cache. Files are identified by the hash of their contents, so the same image
+// reached through different relative paths, or copied under another name, is decoded and uploaded once
+// no matter how many models use it. Canonical paths map to content hashes so a file is only read and
+// hashed the first time it is seen.
+//
+// Loading is split like everything else: Load runs on a worker and only decodes when the texture isn't
+// resident yet (concurrent loads of the same content share one decode), Acquire runs on the GL thread and
+// either returns the resident texture or creates it. Lookups are hash map finds under a mutex.
+//
+// The cache doesn't keep decoded images alive itself: a finished decode is only remembered weakly, for
+// as long as some TextureSource still holds the image, so images that are never acquired go back to the
+// staging pool with their last source.
+class TextureCache {
+public:
+    static TextureCache& Instance() {
+        static TextureCache instance;
+        return instance;
+    }
+
+    TextureCache(const TextureCache&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+
+    // any thread
+    TextureSource Load(const std::string& path, TextureVariant variant = TextureVariant::Material) {
+        TextureSource source;
+        source.path = canonicalPath(path);
+
+        FileView file;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            auto known = m_Paths.find(source.path);
+            if (known != m_Paths.end()) {
+                source.content = known->second;
+            }
+        }
+        if (source.content == 0) {
+            file = VirtualFileSystem::Instance().Read(source.path);
+            if (!file) {
+                return source;
+            }
+            source.content = hashBytes(file.data, file.size);
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Paths[source.path] = source.content;
+        }
+        source.key = variantKey(source.content, variant);
+
+        std::promise<std::shared_ptr<const Image>> decoded;
+        std::shared_future<std::shared_ptr<const Image>> other;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if (m_Textures.count(source.key)) {
+                return source;
+            }
+            auto decoding = m_Decoding.find(source.content);
+            if (decoding != m_Decoding.end() && decoding->second.pending.valid()) {
+                other = decoding->second.pending;
+            } else if (decoding != m_Decoding.end() && (source.image = decoding->second.image.lock())) {
+                return source;
+            } else {
+                m_Decoding[source.content] = Decoding{decoded.get_future().share(), {}};
+            }
+        }
+        if (other.valid()) {
+            // someone else is decoding the same content right now; that thread is running, not queued,
+            // so waiting for it can't deadlock the pool
+            source.image = other.get();
+            return source;
+        }
+
+        Image image = loadBakedImage(source.path, source.content);
+        if (!image) {
+            if (!file) {
+                file = VirtualFileSystem::Instance().Read(source.path);
+            }
+            if (file) {
+                image = decodeImage(file.data, file.size);
+            }
+        }
+        source.image = std::make_shared<const Image>(std::move(image));
+        decoded.set_value(source.image);
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        auto decoding = m_Decoding.find(source.content);
+        if (decoding != m_Decoding.end()) {
+            if (*source.image) {
+                decoding->second = Decoding{{}, source.image};
+            } else {
+                m_Decoding.erase(decoding);
+            }
+        }
+        return source;
+    }
+
+    // GL thread: the cached texture for key, or the one create() returns (0 on failure), cached from now on
+    template<typename Create>
+    CachedTexture Acquire(uint64_t key, Create create) {
+        if (key == 0) {
+            return CachedTexture();
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            auto entry = m_Textures.find(key);
+            if (entry != m_Textures.end()) {
+                ++entry->second.references;
+                return CachedTexture(key, entry->second.texture);
+            }
+        }
+        GLuint texture = create();
+        if (texture == 0) {
+            return CachedTexture();
+        }
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Textures[key] = Entry{texture, 1};
+        return CachedTexture(key, texture);
+    }
+
+    // GL thread: same for a source from Load; create(image) makes the texture from the decoded image
+    template<typename Create>
+    CachedTexture Acquire(const TextureSource& source, Create create) {
+        CachedTexture texture = Acquire(source.key, [&source, &create]() -> GLuint {
+            std::shared_ptr<const Image> image = source.image;
+            if (!image) {
+                // was resident when Load ran but has been released since
+                image = std::make_shared<const Image>(loadImage(source.path));
+            }
+            return *image ? create(image) : 0;
+        });
+        // from now on Load finds the resident texture, the decoded image isn't needed for lookups any more
+        Forget(source);
+        return texture;
+    }
+
+    // any thread: drops the decode of source's content from the lookups, for sources that went into a
+    // texture through Acquire(key, ...), like the faces of a cube map, or won't be acquired at all
+    void Forget(const TextureSource& source) {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        auto decoding = m_Decoding.find(source.content);
+        // a decode still running is left to the Load that started it
+        if (decoding != m_Decoding.end() && !decoding->second.pending.valid()) {
+            m_Decoding.erase(decoding);
+        }
+    }
+
+    // GL thread: callback runs with a texture's name right before the last reference deletes it
+    void OnRelease(std::function<void(GLuint)> callback) {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_OnRelease = std::move(callback);
+    }
+
+    // number of resident textures
+    size_t Size() {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        return m_Textures.size();
+    }
+
+    static uint64_t combineKeys(uint64_t seed, uint64_t key) {
+        return combineHashes(seed, key);
+    }
+
+private:
+    friend class CachedTexture;
+
+    struct Entry {
+        GLuint texture;
+        int references;
+    };
+
+    // a decode in progress, which other loads of the same content wait for, or the image it produced
+    struct Decoding {
+        std::shared_future<std::shared_ptr<const Image>> pending;
+        std::weak_ptr<const Image> image;
+    };
+
+    std::mutex m_Mutex;
+    std::unordered_map<std::string, uint64_t> m_Paths;  // canonical path -> content hash
+    std::unordered_map<uint64_t, Entry> m_Textures;     // content hash + variant -> texture
+    std::unordered_map<uint64_t, Decoding> m_Decoding;  // content hash -> decode
+    std::function<void(GLuint)> m_OnRelease;
+
+    TextureCache() = default;
+
+    void release(uint64_t key) {
+        GLuint texture = 0;
+        std::function<void(GLuint)> onRelease;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            auto entry = m_Textures.find(key);
+            if (entry == m_Textures.end() || --entry->second.references > 0) {
+                return;
+            }
+            texture = entry->second.texture;
+            m_Textures.erase(entry);
+            onRelease = m_OnRelease;
+        }
+        if (onRelease) {
+            onRelease(texture);
+        }
+        glDeleteTextures(1, &texture);
+    }
+
+    static uint64_t variantKey(uint64_t content, TextureVariant variant) {
+        uint64_t key = combineKeys(content, static_cast<uint64_t>(variant));
+        return key != 0 ? key : 1;
+    }
+};
+
+inline void CachedTexture::reset() {
+    if (m_Key != 0) {
+        TextureCache::Instance().release(m_Key);
+    }
+    m_Key = 0;
+    m_Name = 0;
+}
+
+}
+
+#endif //PROJECT_BASE_TEXTURECACHE_H
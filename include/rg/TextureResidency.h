@@ -0,0 +1,447 @@
+#ifndef PROJECT_BASE_TEXTURERESIDENCY_H
+#define PROJECT_BASE_TEXTURERESIDENCY_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <rg/BlockCompression.h>
+#include <rg/Image.h>
+#include <rg/TextureCache.h>
+#include <rg/ThreadPool.h>
+#include <rg/UploadScheduler.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace rg {
+
+// Keeps only the mip levels of each material texture that the screen needs resident, under a VRAM budget.
+//
+// Every frame the render queue reports how large each drawn object is on screen (Request), which gives
+// the finest level its textures can show. Update then streams missing levels in, the most visible
+// deficits first: the file is read again on a worker, the levels are cut from its baked chain (or
+// box-filtered down from the decoded image) and go through the upload scheduler, and GL_TEXTURE_BASE_LEVEL
+// drops once they have arrived. When that would exceed the budget, levels are evicted from the least
+// recently used textures first by raising their base level and redefining the levels above it as empty,
+// which frees their storage while the texture name and the coarser levels stay valid.
+//
+// A small mip tail (tailSize texels on the larger side) always stays resident, so a texture never goes
+// black. Baked textures start out with just that tail; decoded ones have no lower levels until
+// glGenerateMipmap has run, so they are uploaded whole and trimmed afterwards.
+//
+// GL thread only, apart from the file reads it hands to the workers.
+class TextureResidency {
+public:
+    explicit TextureResidency(ThreadPool& workers, UploadScheduler& uploads, size_t budgetBytes = 256 * 1024 * 1024,
+                              int tailSize = 64, int maxStreaming = 2)
+            : m_Workers(workers), m_Uploads(uploads), m_Budget(budgetBytes), m_TailSize(tailSize),
+              m_MaxStreaming(maxStreaming) {
+        // textures shared through the cache are only forgotten once their last user is gone
+        TextureCache::Instance().OnRelease([this](GLuint texture) { m_Textures.erase(texture); });
+    }
+
+    ~TextureResidency() {
+        TextureCache::Instance().OnRelease(nullptr);
+    }
+
+    TextureResidency(const TextureResidency&) = delete;
+    TextureResidency& operator=(const TextureResidency&) = delete;
+
+    // Creates a repeating, trilinear GL_TEXTURE_2D for a decoded material image and tracks it from now on.
+    // path is read again whenever levels have to be streamed back in; srgb marks color images.
+    GLuint Create(std::shared_ptr<const Image> image, const std::string& path, bool srgb = false) {
+        GLuint texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+
+        Entry entry;
+        entry.serial = ++m_Serial;
+        entry.path = path;
+        entry.width = image->width;
+        entry.height = image->height;
+        entry.channels = image->channels;
+        entry.srgb = srgb;
+        if (image->compressed) {
+            const CompressedImage& compressed = image->compressed;
+            entry.compressed = true;
+            entry.blockFormat = compressed.format;
+            entry.format = compressedFormat(compressed.format, srgb);
+            entry.internalFormat = entry.format;
+            entry.levels = static_cast<int>(compressed.levels.size());
+            entry.base = tailLevel(entry);
+            for (int level = entry.base; level < entry.levels; ++level) {
+                const MipLevel& mip = compressed.levels[level];
+                m_Uploads.UploadLevel(texture, GL_TEXTURE_2D, GL_TEXTURE_2D, level, entry.internalFormat, entry.format,
+                                      true, mip.width, mip.height, compressed.data.data() + mip.offset, mip.size, image);
+            }
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, entry.base);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, entry.levels - 1);
+        } else {
+            entry.format = imageFormat(image->channels);
+            entry.internalFormat = imageInternalFormat(image->channels, srgb);
+            entry.levels = 1 + static_cast<int>(std::log2(std::max(entry.width, entry.height)));
+            entry.base = 0;
+            m_Uploads.UploadImage(texture, GL_TEXTURE_2D, GL_TEXTURE_2D, image, true, srgb);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        // nothing is evicted while the first upload is still in flight
+        entry.streaming = true;
+        entry.wanted = entry.base;
+        uint64_t serial = entry.serial;
+        m_Uploads.Then([this, texture, serial] {
+            if (Entry* uploaded = find(texture, serial)) {
+                uploaded->streaming = false;
+            }
+        });
+        m_Textures[texture] = std::move(entry);
+        return texture;
+    }
+
+    // camera for this frame's requests; pixels per world unit at distance 1 follow from the projection
+    void Begin(const glm::vec3& viewPosition, const glm::mat4& projection, int viewportHeight) {
+        m_ViewPosition = viewPosition;
+        m_PixelsPerUnit = projection[1][1] * viewportHeight * 0.5f;
+    }
+
+    // projected diameter in pixels of a bounding sphere, for Request
+    float ScreenSize(const glm::vec3& center, float radius) const {
+        float distance = glm::length(center - m_ViewPosition) - radius;
+        if (distance <= 0.01f) {
+            // the camera is inside or right at the object
+            return 1e9f;
+        }
+        return 2.0f * radius * m_PixelsPerUnit / distance;
+    }
+
+    // The texture is drawn this frame on an object screenSize pixels across. Assuming its UVs span the
+    // object once, every level whose larger side exceeds that is wasted; mipBias shifts the choice.
+    void Request(GLuint texture, float screenSize) {
+        auto found = m_Textures.find(texture);
+        if (found == m_Textures.end()) {
+            return;
+        }
+        Entry& entry = found->second;
+        if (entry.lastUsed != m_Frame) {
+            entry.lastUsed = m_Frame;
+            entry.wanted = tailLevel(entry);
+        }
+        float texelsPerPixel = std::max(entry.width, entry.height) / std::max(screenSize, 1.0f);
+        int level = static_cast<int>(std::floor(std::log2(std::max(texelsPerPixel, 1.0f)) + m_MipBias));
+        entry.wanted = std::min(entry.wanted, std::max(level, 0));
+    }
+
+    // call once per frame, after the frame's requests
+    void Update() {
+        finishStreaming();
+
+        // textures drawn this frame that are missing levels, the largest deficits first
+        std::vector<std::pair<GLuint, Entry*>> missing;
+        for (auto& texture : m_Textures) {
+            Entry& entry = texture.second;
+            if (entry.lastUsed == m_Frame && entry.wanted < entry.base && !entry.streaming && entry.streamable) {
+                missing.emplace_back(texture.first, &entry);
+            }
+        }
+        std::sort(missing.begin(), missing.end(), [](const std::pair<GLuint, Entry*>& a, const std::pair<GLuint, Entry*>& b) {
+            return a.second->base - a.second->wanted > b.second->base - b.second->wanted;
+        });
+
+        size_t resident = ResidentBytes() + m_Reserved;
+        for (const std::pair<GLuint, Entry*>& texture : missing) {
+            if (static_cast<int>(m_Jobs.size()) >= m_MaxStreaming) {
+                break;
+            }
+            Entry& entry = *texture.second;
+            size_t cost = bytes(entry, entry.wanted, entry.base);
+            if (resident + cost > m_Budget) {
+                resident -= evict(resident + cost - m_Budget, texture.first);
+            }
+            // stream in as much of it as fits
+            int first = entry.wanted;
+            while (first < entry.base && resident + bytes(entry, first, entry.base) > m_Budget) {
+                ++first;
+            }
+            if (first == entry.base) {
+                continue;
+            }
+            cost = bytes(entry, first, entry.base);
+            stream(texture.first, entry, first, cost);
+            resident += cost;
+        }
+
+        // the budget may have been lowered
+        if (resident > m_Budget) {
+            evict(resident - m_Budget, 0);
+        }
+        ++m_Frame;
+    }
+
+    void SetBudget(size_t budgetBytes) {
+        m_Budget = budgetBytes;
+    }
+
+    size_t Budget() const {
+        return m_Budget;
+    }
+
+    void SetMipBias(float bias) {
+        m_MipBias = bias;
+    }
+
+    // bytes of the allocated levels of every tracked texture, as specified (drivers may pad)
+    size_t ResidentBytes() const {
+        size_t resident = 0;
+        for (const auto& texture : m_Textures) {
+            resident += bytes(texture.second, texture.second.base, texture.second.levels);
+        }
+        return resident;
+    }
+
+    // bytes a full mip chain of every tracked texture would take
+    size_t FullBytes() const {
+        size_t full = 0;
+        for (const auto& texture : m_Textures) {
+            full += bytes(texture.second, 0, texture.second.levels);
+        }
+        return full;
+    }
+
+    size_t Tracked() const {
+        return m_Textures.size();
+    }
+
+    size_t Streaming() const {
+        return m_Jobs.size();
+    }
+
+private:
+    struct Entry {
+        uint64_t serial = 0;        // GL names are reused, jobs and callbacks check this instead
+        std::string path;
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+        bool srgb = false;          // color image, its levels are filtered in linear light
+        bool compressed = false;
+        BlockFormat blockFormat = BlockFormat::BC1;
+        GLenum internalFormat = GL_RGB;
+        GLenum format = GL_RGB;     // same block format when compressed, pixel format otherwise
+        int levels = 1;
+        int base = 0;               // finest allocated level
+        int wanted = 0;             // finest level the last frame that drew the texture needed
+        uint64_t lastUsed = 0;
+        bool streaming = false;     // uploads in flight, levels must not be touched
+        bool streamable = true;     // cleared when the file no longer matches the texture
+    };
+
+    // levels first..last-1 cut or filtered from the file, in order
+    struct StreamedLevels {
+        std::vector<MipLevel> levels;
+        std::vector<unsigned char> data;
+    };
+
+    struct Job {
+        GLuint texture;
+        uint64_t serial;
+        int first;
+        size_t bytes;
+        std::future<std::shared_ptr<StreamedLevels>> levels;
+    };
+
+    ThreadPool& m_Workers;
+    UploadScheduler& m_Uploads;
+    size_t m_Budget;
+    int m_TailSize;
+    int m_MaxStreaming;
+    float m_MipBias = 0.0f;
+    std::unordered_map<GLuint, Entry> m_Textures;
+    std::vector<Job> m_Jobs;
+    size_t m_Reserved = 0;          // bytes of the levels the jobs will allocate
+    uint64_t m_Serial = 0;
+    uint64_t m_Frame = 1;
+    glm::vec3 m_ViewPosition = glm::vec3(0.0f);
+    float m_PixelsPerUnit = 1.0f;
+
+    Entry* find(GLuint texture, uint64_t serial) {
+        auto found = m_Textures.find(texture);
+        return found != m_Textures.end() && found->second.serial == serial ? &found->second : nullptr;
+    }
+
+    // coarsest level that is always resident
+    int tailLevel(const Entry& entry) const {
+        int level = 0;
+        while (level < entry.levels - 1 && std::max(entry.width >> level, entry.height >> level) > m_TailSize) {
+            ++level;
+        }
+        return level;
+    }
+
+    static size_t bytes(const Entry& entry, int first, int last) {
+        size_t total = 0;
+        for (int level = first; level < last; ++level) {
+            int width = std::max(entry.width >> level, 1);
+            int height = std::max(entry.height >> level, 1);
+            total += entry.compressed ? compressedLevelSize(entry.blockFormat, width, height)
+                                      : static_cast<size_t>(width) * height * entry.channels;
+        }
+        return total;
+    }
+
+    // Drops the finest levels of the least recently used textures until needed bytes are free, never
+    // below the tail of an idle texture or below what a texture drawn this frame needs. Returns the
+    // bytes freed.
+    size_t evict(size_t needed, GLuint keep) {
+        std::vector<std::pair<GLuint, Entry*>> candidates;
+        for (auto& texture : m_Textures) {
+            if (texture.first != keep && !texture.second.streaming && texture.second.base < floorLevel(texture.second)) {
+                candidates.emplace_back(texture.first, &texture.second);
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(), [](const std::pair<GLuint, Entry*>& a, const std::pair<GLuint, Entry*>& b) {
+            return a.second->lastUsed < b.second->lastUsed;
+        });
+
+        size_t freed = 0;
+        for (const std::pair<GLuint, Entry*>& texture : candidates) {
+            if (freed >= needed) {
+                break;
+            }
+            Entry& entry = *texture.second;
+            int base = entry.base;
+            int floor = floorLevel(entry);
+            while (base < floor && freed < needed) {
+                freed += bytes(entry, base, base + 1);
+                ++base;
+            }
+            glBindTexture(GL_TEXTURE_2D, texture.first);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, base);
+            // levels below the base don't count for completeness, empty ones give their storage back
+            for (int level = entry.base; level < base; ++level) {
+                if (entry.compressed) {
+                    glCompressedTexImage2D(GL_TEXTURE_2D, level, entry.internalFormat, 0, 0, 0, 0, nullptr);
+                } else {
+                    glTexImage2D(GL_TEXTURE_2D, level, entry.internalFormat, 0, 0, 0, entry.format, GL_UNSIGNED_BYTE,
+                                 nullptr);
+                }
+            }
+            entry.base = base;
+        }
+        return freed;
+    }
+
+    int floorLevel(const Entry& entry) const {
+        return entry.lastUsed == m_Frame ? entry.wanted : tailLevel(entry);
+    }
+
+    void stream(GLuint texture, Entry& entry, int first, size_t cost) {
+        entry.streaming = true;
+        m_Reserved += cost;
+        Job job;
+        job.texture = texture;
+        job.serial = entry.serial;
+        job.first = first;
+        job.bytes = cost;
+        Entry copy = entry;
+        int last = entry.base;
+        job.levels = m_Workers.Submit([copy, first, last] { return readLevels(copy, first, last); });
+        m_Jobs.push_back(std::move(job));
+    }
+
+    // worker: levels first..last-1 of the texture's file, or nullptr if it doesn't match the texture anymore
+    static std::shared_ptr<StreamedLevels> readLevels(const Entry& entry, int first, int last) {
+        Image image = loadImage(entry.path);
+        if (image.width != entry.width || image.height != entry.height || image.channels != entry.channels ||
+            static_cast<bool>(image.compressed) != entry.compressed) {
+            return nullptr;
+        }
+        std::shared_ptr<StreamedLevels> streamed = std::make_shared<StreamedLevels>();
+        if (entry.compressed) {
+            const CompressedImage& compressed = image.compressed;
+            if (compressed.format != entry.blockFormat || static_cast<int>(compressed.levels.size()) < last) {
+                return nullptr;
+            }
+            for (int level = first; level < last; ++level) {
+                MipLevel mip = compressed.levels[level];
+                const unsigned char* data = compressed.data.data() + mip.offset;
+                mip.offset = streamed->data.size();
+                streamed->data.insert(streamed->data.end(), data, data + mip.size);
+                streamed->levels.push_back(mip);
+            }
+        } else {
+            int width = image.width;
+            int height = image.height;
+            std::vector<unsigned char> pixels(image.pixels.get(),
+                                              image.pixels.get() + static_cast<size_t>(width) * height * image.channels);
+            image.pixels.reset();
+            for (int level = 0; level < last; ++level) {
+                if (level >= first) {
+                    MipLevel mip;
+                    mip.width = width;
+                    mip.height = height;
+                    mip.offset = streamed->data.size();
+                    mip.size = pixels.size();
+                    streamed->data.insert(streamed->data.end(), pixels.begin(), pixels.end());
+                    streamed->levels.push_back(mip);
+                }
+                if (level + 1 < last) {
+                    pixels = bc::downsample(pixels, width, height, image.channels, entry.srgb);
+                    width = std::max(width / 2, 1);
+                    height = std::max(height / 2, 1);
+                }
+            }
+        }
+        return streamed;
+    }
+
+    // hands the levels of finished jobs to the upload scheduler; the base level drops once they are in
+    void finishStreaming() {
+        for (size_t i = 0; i < m_Jobs.size();) {
+            Job& job = m_Jobs[i];
+            if (job.levels.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                ++i;
+                continue;
+            }
+            std::shared_ptr<StreamedLevels> streamed = job.levels.get();
+            m_Reserved -= job.bytes;
+            Entry* entry = find(job.texture, job.serial);
+            if (entry && !streamed) {
+                entry->streaming = false;
+                entry->streamable = false;
+            } else if (entry) {
+                GLuint texture = job.texture;
+                uint64_t serial = job.serial;
+                int first = job.first;
+                for (size_t level = 0; level < streamed->levels.size(); ++level) {
+                    const MipLevel& mip = streamed->levels[level];
+                    m_Uploads.UploadLevel(texture, GL_TEXTURE_2D, GL_TEXTURE_2D, first + static_cast<GLint>(level),
+                                          entry->internalFormat, entry->format, entry->compressed, mip.width, mip.height,
+                                          streamed->data.data() + mip.offset, mip.size, streamed);
+                }
+                entry->base = first;
+                m_Uploads.Then([this, texture, serial, first] {
+                    if (Entry* uploaded = find(texture, serial)) {
+                        glBindTexture(GL_TEXTURE_2D, texture);
+                        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, first);
+                        uploaded->streaming = false;
+                    }
+                });
+            }
+            m_Jobs.erase(m_Jobs.begin() + i);
+        }
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_TEXTURERESIDENCY_H
@@ -0,0 +1,131 @@
+#ifndef PROJECT_BASE_THREADPOOL_H
+#define PROJECT_BASE_THREADPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rg {
+
+// Fixed set of worker threads pulling jobs from a FIFO queue. Used for everything that can run off
+// the GL thread: model imports, mesh conversion, image decoding.
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned int threadCount = defaultThreadCount()) {
+        threadCount = std::max(threadCount, 1u);
+        for (unsigned int i = 0; i < threadCount; ++i) {
+            m_Workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stopping = true;
+        }
+        m_Condition.notify_all();
+        for (std::thread& worker : m_Workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    static unsigned int defaultThreadCount() {
+        return std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    size_t Size() const {
+        return m_Workers.size();
+    }
+
+    // queues a job and returns a future for its result
+    template<typename F>
+    auto Submit(F&& job) -> std::future<decltype(job())> {
+        using Result = decltype(job());
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(job));
+        std::future<Result> result = task->get_future();
+        enqueue([task] { (*task)(); });
+        return result;
+    }
+
+    // runs body(0) ... body(count - 1) spread over the workers and returns when all are done.
+    // The calling thread takes indices too, so this is safe to call from inside a pool job:
+    // if every worker is busy the caller simply does all the work itself.
+    template<typename F>
+    void ParallelFor(size_t count, const F& body) {
+        if (count == 0) {
+            return;
+        }
+        struct State {
+            std::atomic<size_t> next{0};
+            std::atomic<size_t> done{0};
+            std::mutex mutex;
+            std::condition_variable finished;
+        };
+        std::shared_ptr<State> state = std::make_shared<State>();
+        // body is only touched while an index < count is being processed, which can't outlive this call
+        auto work = [state, count, &body] {
+            size_t i;
+            while ((i = state->next.fetch_add(1)) < count) {
+                body(i);
+                if (state->done.fetch_add(1) + 1 == count) {
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    state->finished.notify_all();
+                }
+            }
+        };
+
+        size_t helpers = std::min(count - 1, m_Workers.size());
+        for (size_t i = 0; i < helpers; ++i) {
+            enqueue(work);
+        }
+        work();
+
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->finished.wait(lock, [&state, count] { return state->done.load() == count; });
+    }
+
+private:
+    std::vector<std::thread> m_Workers;
+    std::deque<std::function<void()>> m_Jobs;
+    std::mutex m_Mutex;
+    std::condition_variable m_Condition;
+    bool m_Stopping = false;
+
+    void enqueue(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Jobs.push_back(std::move(job));
+        }
+        m_Condition.notify_one();
+    }
+
+    void workerLoop() {
+        for (;;) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_Condition.wait(lock, [this] { return m_Stopping || !m_Jobs.empty(); });
+                if (m_Stopping && m_Jobs.empty()) {
+                    return;
+                }
+                job = std::move(m_Jobs.front());
+                m_Jobs.pop_front();
+            }
+            job();
+        }
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_THREADPOOL_H
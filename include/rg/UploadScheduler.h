@@ -0,0 +1,346 @@
+#ifndef PROJECT_BASE_UPLOADSCHEDULER_H
+#define PROJECT_BASE_UPLOADSCHEDULER_H
+
+#include <glad/glad.h>
+
+#include <rg/GLResource.h>
+#include <rg/Image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace rg {
+
+// Streams texture and buffer data to the GPU a slice per frame. Uploads are queued on the GL thread and
+// Update, called once per frame, copies at most bytesPerFrame bytes (or as much as fits in
+// microsecondsPerFrame) into one slot of a ring of pixel buffer objects and issues the matching
+// glTexSubImage2D / glCopyBufferSubData calls from there. Every slot is fenced after use and only
+// refilled once the GPU has consumed it, so neither the copy nor the transfer ever stalls the frame;
+// a large texture simply takes a few frames to arrive.
+//
+// Storage is allocated when an upload is queued, with undefined contents until it is done. Use Then
+// to find out when that is: its callback runs after everything queued before it has been issued, so
+// callers usually stream into a fresh object and swap it in from there.
+class UploadScheduler {
+public:
+    explicit UploadScheduler(size_t bytesPerFrame = 8 * 1024 * 1024, int microsecondsPerFrame = 2000,
+                             int ringSize = 3)
+            : m_SlotSize(bytesPerFrame), m_TimeBudget(microsecondsPerFrame) {
+        m_Slots.resize(std::max(ringSize, 1));
+        for (Slot& slot : m_Slots) {
+            slot.buffer = GLBuffer::create();
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, m_SlotSize, nullptr, GL_STREAM_DRAW);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    ~UploadScheduler() {
+        for (Slot& slot : m_Slots) {
+            if (slot.fence) {
+                glDeleteSync(slot.fence);
+            }
+        }
+    }
+
+    UploadScheduler(const UploadScheduler&) = delete;
+    UploadScheduler& operator=(const UploadScheduler&) = delete;
+
+    // copies size bytes from data to offset in buffer; owner keeps data alive until then
+    void UploadBuffer(GLuint buffer, size_t offset, const void* data, size_t size, std::shared_ptr<const void> owner) {
+        Upload upload;
+        upload.kind = Upload::Buffer;
+        upload.owner = std::move(owner);
+        upload.data = static_cast<const unsigned char*>(data);
+        upload.size = size;
+        upload.unitBytes = 1;
+        upload.buffer = buffer;
+        upload.bufferOffset = offset;
+        m_Queue.push_back(std::move(upload));
+    }
+
+    template<typename T>
+    void UploadBuffer(GLuint buffer, std::vector<T>&& data, size_t offset = 0) {
+        std::shared_ptr<std::vector<T>> owned = std::make_shared<std::vector<T>>(std::move(data));
+        UploadBuffer(buffer, offset, owned->data(), owned->size() * sizeof(T), owned);
+    }
+
+    // Allocates the image's storage in target (GL_TEXTURE_2D or a cube map face of a texture bound to
+    // bindTarget) and queues its pixels: every baked level of a compressed image, the base level of a
+    // decoded one. With completeMipChain the chain is finished (rg::finishMipChain) after the last level.
+    // srgb stores color images as sRGB (rg::imageInternalFormat).
+    void UploadImage(GLuint texture, GLenum bindTarget, GLenum target, Image&& image, bool completeMipChain,
+                     bool srgb = false) {
+        UploadImage(texture, bindTarget, target, std::make_shared<const Image>(std::move(image)), completeMipChain,
+                    srgb);
+    }
+
+    // same, for an image that is shared with others (rg::TextureCache); it is kept alive until uploaded
+    void UploadImage(GLuint texture, GLenum bindTarget, GLenum target, std::shared_ptr<const Image> owned,
+                     bool completeMipChain, bool srgb = false) {
+        if (owned->compressed) {
+            const CompressedImage& compressed = owned->compressed;
+            GLenum format = compressedFormat(compressed.format, srgb);
+            for (size_t level = 0; level < compressed.levels.size(); ++level) {
+                const MipLevel& mip = compressed.levels[level];
+                UploadLevel(texture, bindTarget, target, static_cast<GLint>(level), format, format, true, mip.width,
+                            mip.height, compressed.data.data() + mip.offset, mip.size, owned);
+            }
+        } else if (*owned) {
+            UploadLevel(texture, bindTarget, target, 0, imageInternalFormat(owned->channels, srgb),
+                        imageFormat(owned->channels), false, owned->width, owned->height, owned->pixels.get(),
+                        static_cast<size_t>(owned->width) * owned->channels * owned->height, owned);
+        }
+        if (completeMipChain && *owned) {
+            Then([texture, bindTarget, owned] {
+                glBindTexture(bindTarget, texture);
+                finishMipChain(bindTarget, *owned);
+            });
+        }
+    }
+
+    // Allocates one mip level of target with internalFormat and queues its size bytes of data. For compressed
+    // levels format is the same block format, otherwise the pixel format of tightly packed 8-bit texels;
+    // owner keeps data alive until it is uploaded.
+    void UploadLevel(GLuint texture, GLenum bindTarget, GLenum target, GLint level, GLenum internalFormat,
+                     GLenum format, bool compressed, int width, int height, const unsigned char* data, size_t size,
+                     std::shared_ptr<const void> owner) {
+        glBindTexture(bindTarget, texture);
+        Upload upload;
+        upload.kind = Upload::Texture;
+        upload.owner = std::move(owner);
+        upload.texture = texture;
+        upload.bindTarget = bindTarget;
+        upload.target = target;
+        upload.compressed = compressed;
+        upload.level = level;
+        upload.width = width;
+        upload.height = height;
+        upload.format = format;
+        upload.data = data;
+        upload.size = size;
+        if (compressed) {
+            glCompressedTexImage2D(target, level, internalFormat, width, height, 0, static_cast<GLsizei>(size), nullptr);
+            // one row of 4x4 blocks at a time
+            upload.rowsPerUnit = 4;
+            upload.unitBytes = size / ((height + 3) / 4);
+        } else {
+            glTexImage2D(target, level, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+            upload.unitBytes = size / height;
+        }
+        m_Queue.push_back(std::move(upload));
+    }
+
+    // runs callback on the GL thread once everything queued so far has been issued
+    void Then(std::function<void()> callback) {
+        Upload upload;
+        upload.kind = Upload::Callback;
+        upload.callback = std::move(callback);
+        m_Queue.push_back(std::move(upload));
+    }
+
+    // issues this frame's share of the queue; call once per frame
+    void Update() {
+        m_UploadedBytes = 0;
+        if (m_Queue.empty()) {
+            return;
+        }
+        Slot& slot = m_Slots[m_Current];
+        if (slot.fence) {
+            GLint status = GL_UNSIGNALED;
+            glGetSynciv(slot.fence, GL_SYNC_STATUS, 1, nullptr, &status);
+            if (status != GL_SIGNALED) {
+                // the GPU is still reading this slot; rather than wait, try again next frame
+                return;
+            }
+            glDeleteSync(slot.fence);
+            slot.fence = nullptr;
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        auto outOfTime = [this, start] {
+            return std::chrono::steady_clock::now() - start > std::chrono::microseconds(m_TimeBudget);
+        };
+
+        // 1. copy this frame's share into the slot and note what to issue from where
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+        unsigned char* mapped = static_cast<unsigned char*>(glMapBufferRange(
+                GL_PIXEL_UNPACK_BUFFER, 0, m_SlotSize,
+                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+        if (!mapped) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            return;
+        }
+        std::vector<Step> steps;
+        size_t used = 0;
+        size_t finished = 0;
+        for (size_t i = 0; i < m_Queue.size(); ++i) {
+            Upload& upload = m_Queue[i];
+            if (upload.kind == Upload::Callback) {
+                steps.push_back(Step{i, 0, 0, 0, false});
+                finished = i + 1;
+                continue;
+            }
+            while (upload.issued < upload.size) {
+                size_t offset = (used + 15) & ~size_t(15);
+                size_t room = offset < m_SlotSize ? m_SlotSize - offset : 0;
+                if (room < upload.unitBytes) {
+                    if (used == 0) {
+                        // a single row bigger than a slot goes straight from client memory
+                        steps.push_back(Step{i, upload.issued, upload.unitBytes, 0, true});
+                        upload.issued += upload.unitBytes;
+                        used = m_SlotSize;
+                    }
+                    break;
+                }
+                size_t bytes = std::min(room / upload.unitBytes * upload.unitBytes, upload.size - upload.issued);
+                std::memcpy(mapped + offset, upload.data + upload.issued, bytes);
+                steps.push_back(Step{i, upload.issued, bytes, offset, false});
+                upload.issued += bytes;
+                used = offset + bytes;
+                if (outOfTime()) {
+                    break;
+                }
+            }
+            if (upload.issued < upload.size || outOfTime()) {
+                finished = upload.issued < upload.size ? i : i + 1;
+                break;
+            }
+            finished = i + 1;
+        }
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        // 2. issue the transfers, in queue order so callbacks see everything before them
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (const Step& step : steps) {
+            issue(m_Queue[step.upload], step, slot.buffer);
+            m_UploadedBytes += step.size;
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        if (used > 0) {
+            slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            m_Current = (m_Current + 1) % m_Slots.size();
+        }
+        m_Queue.erase(m_Queue.begin(), m_Queue.begin() + finished);
+    }
+
+    bool Idle() const {
+        return m_Queue.empty();
+    }
+
+    // bytes still waiting to be issued
+    size_t PendingBytes() const {
+        size_t pending = 0;
+        for (const Upload& upload : m_Queue) {
+            pending += upload.size - upload.issued;
+        }
+        return pending;
+    }
+
+    // bytes issued by the last Update
+    size_t UploadedBytes() const {
+        return m_UploadedBytes;
+    }
+
+private:
+    struct Upload {
+        enum Kind { Buffer, Texture, Callback } kind = Callback;
+        std::shared_ptr<const void> owner;  // keeps data alive
+        const unsigned char* data = nullptr;
+        size_t size = 0;
+        size_t issued = 0;
+        size_t unitBytes = 0;               // transfers are whole multiples of this (rows for textures)
+
+        GLuint buffer = 0;
+        size_t bufferOffset = 0;
+
+        GLuint texture = 0;
+        GLenum bindTarget = GL_TEXTURE_2D;
+        GLenum target = GL_TEXTURE_2D;
+        GLint level = 0;
+        int width = 0;
+        int height = 0;
+        int rowsPerUnit = 1;
+        GLenum format = GL_RGB;             // pixel format, or internal format when compressed
+        bool compressed = false;
+
+        std::function<void()> callback;
+    };
+
+    // part of an upload issued this frame, from slotOffset in the slot (or from client memory if direct)
+    struct Step {
+        size_t upload;
+        size_t sourceOffset;
+        size_t size;
+        size_t slotOffset;
+        bool direct;
+    };
+
+    struct Slot {
+        GLBuffer buffer;
+        GLsync fence = nullptr;
+    };
+
+    std::vector<Slot> m_Slots;
+    size_t m_Current = 0;
+    size_t m_SlotSize;
+    int m_TimeBudget;
+    std::deque<Upload> m_Queue;
+    size_t m_UploadedBytes = 0;
+
+    void issue(Upload& upload, const Step& step, GLuint slotBuffer) {
+        if (step.direct) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        const void* source = step.direct ? static_cast<const void*>(upload.data + step.sourceOffset)
+                                         : reinterpret_cast<const void*>(step.slotOffset);
+        switch (upload.kind) {
+            case Upload::Buffer:
+                glBindBuffer(GL_COPY_WRITE_BUFFER, upload.buffer);
+                if (step.direct) {
+                    glBufferSubData(GL_COPY_WRITE_BUFFER, upload.bufferOffset + step.sourceOffset, step.size, source);
+                } else {
+                    glBindBuffer(GL_COPY_READ_BUFFER, slotBuffer);
+                    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, step.slotOffset,
+                                        upload.bufferOffset + step.sourceOffset, step.size);
+                }
+                break;
+            case Upload::Texture: {
+                int y = static_cast<int>(step.sourceOffset / upload.unitBytes) * upload.rowsPerUnit;
+                int rows = std::min(static_cast<int>(step.size / upload.unitBytes) * upload.rowsPerUnit,
+                                    upload.height - y);
+                glBindTexture(upload.bindTarget, upload.texture);
+                if (upload.compressed) {
+                    glCompressedTexSubImage2D(upload.target, upload.level, 0, y, upload.width, rows, upload.format,
+                                              static_cast<GLsizei>(step.size), source);
+                } else {
+                    glTexSubImage2D(upload.target, upload.level, 0, y, upload.width, rows, upload.format,
+                                    GL_UNSIGNED_BYTE, source);
+                }
+                break;
+            }
+            case Upload::Callback:
+                // callbacks may queue more work, which must not see the slot bound
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+                upload.callback();
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slotBuffer);
+                break;
+        }
+        if (step.direct) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slotBuffer);
+        }
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_UPLOADSCHEDULER_H
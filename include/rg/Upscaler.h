@@ -0,0 +1,79 @@
+#ifndef PROJECT_BASE_UPSCALER_H
+#define PROJECT_BASE_UPSCALER_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/shader.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace rg {
+
+// Brings a scene rendered below the window's resolution up to it, in the two passes of AMD's FidelityFX
+// Super Resolution 1.0: edge adaptive upsampling (upscale_easu.fs) and contrast adaptive sharpening
+// (upscale_rcas.fs). Both want tone mapped, perceptually encoded colors, so the composite draws at the
+// scene's resolution with sRGB encoded output into a FORMAT texture, Upsample takes it to the window's
+// resolution in another and Sharpen from there to the window. The frame's render graph provides the
+// textures and binds the framebuffers. At or above the window's resolution it isn't needed and the
+// composite draws straight to the window as before.
+class Upscaler {
+public:
+    // 8 bits per channel are enough for sRGB encoded colors; both passes fetch texels, so no filtering
+    static const GLenum FORMAT = GL_RGBA8;
+
+    // drawQuad draws a full screen quad with positions at location 0 and texture coordinates at 1
+    explicit Upscaler(void (*drawQuad)())
+            : m_DrawQuad(drawQuad),
+              m_Easu("resources/shaders/blur.vs", "resources/shaders/upscale_easu.fs"),
+              m_Rcas("resources/shaders/blur.vs", "resources/shaders/upscale_rcas.fs") {
+        m_Easu.use();
+        m_Easu.setInt("image", 0);
+        m_Rcas.use();
+        m_Rcas.setInt("image", 0);
+    }
+
+    void SetEnabled(bool enabled) {
+        m_Enabled = enabled;
+    }
+
+    // sharpening in stops below the strongest: 0 is the strongest, 2 hardly visible
+    void SetSharpness(float stops) {
+        m_Sharpness = std::max(0.0f, stops);
+    }
+
+    // whether a scene of input size has to be upscaled for an output of output size
+    bool Active(int inputWidth, int inputHeight, int outputWidth, int outputHeight) const {
+        return m_Enabled && (inputWidth < outputWidth || inputHeight < outputHeight);
+    }
+
+    // Draws input, inputWidth x inputHeight, upscaled to the bound framebuffer, whose viewport is
+    // width x height. Both passes write an alpha of 1, so blending doesn't matter.
+    void Upsample(GLuint input, int inputWidth, int inputHeight, int width, int height) {
+        glActiveTexture(GL_TEXTURE0);
+        m_Easu.use();
+        m_Easu.setVec2("scale", static_cast<float>(inputWidth) / width, static_cast<float>(inputHeight) / height);
+        glBindTexture(GL_TEXTURE_2D, input);
+        m_DrawQuad();
+    }
+
+    // draws input sharpened to the bound framebuffer of the same size; expects GL_FRAMEBUFFER_SRGB off
+    void Sharpen(GLuint input) {
+        glActiveTexture(GL_TEXTURE0);
+        m_Rcas.use();
+        m_Rcas.setFloat("sharpness", std::exp2(-m_Sharpness));
+        glBindTexture(GL_TEXTURE_2D, input);
+        m_DrawQuad();
+    }
+
+private:
+    void (*m_DrawQuad)();
+    Shader m_Easu;
+    Shader m_Rcas;
+    bool m_Enabled = true;
+    float m_Sharpness = 0.25f;
+};
+
+}
+
+#endif //PROJECT_BASE_UPSCALER_H
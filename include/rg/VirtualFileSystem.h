@@ -0,0 +1,153 @@
+#ifndef PROJECT_BASE_VIRTUALFILESYSTEM_H
+#define PROJECT_BASE_VIRTUALFILESYSTEM_H
+
+#include <rg/AssetPack.h>
+
+#include <unistd.h>
+
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace rg {
+
+namespace vfs {
+
+// the working directory, taken once: nothing changes it after startup
+inline const std::string& workingDirectory() {
+    static const std::string directory = [] {
+        char buffer[PATH_MAX];
+        return getcwd(buffer, sizeof(buffer)) ? std::string(buffer) : std::string();
+    }();
+    return directory;
+}
+
+// the deepest existing directory on the way to directory resolved with realpath, with the rest appended
+inline std::string resolveDirectory(const std::string& directory) {
+    char resolved[PATH_MAX];
+    for (size_t end = directory.size(); end != std::string::npos && end > 0; end = directory.find_last_of('/', end - 1)) {
+        if (realpath(directory.substr(0, end).c_str(), resolved)) {
+            return normalizePath(std::string(resolved) + directory.substr(end));
+        }
+    }
+    return directory;
+}
+
+}
+
+// Absolute path with the symlinks in its directories resolved, like realpath, also for files that only
+// exist inside a pack: the deepest directory on the way that exists is resolved and the rest is appended,
+// lexically normalized. Mount points and lookups both go through this, as do the texture cache's keys,
+// so they agree. Every directory is resolved once and remembered, so a lookup costs no file system calls
+// after the first in its directory; directories created or relinked while running aren't noticed.
+inline std::string canonicalPath(const std::string& path) {
+    std::string name = normalizePath(!path.empty() && path[0] == '/' ? path : vfs::workingDirectory() + "/" + path);
+    size_t slash = name.find_last_of('/');
+    if (slash == std::string::npos || slash == 0) {
+        return name;
+    }
+    std::string directory = name.substr(0, slash);
+
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::string> resolved;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto known = resolved.find(directory);
+        if (known != resolved.end()) {
+            return known->second + name.substr(slash);
+        }
+    }
+    std::string canonical = vfs::resolveDirectory(directory);
+    std::lock_guard<std::mutex> lock(mutex);
+    resolved.emplace(directory, canonical);
+    return canonical + name.substr(slash);
+}
+
+// Every asset read goes through here. Files inside a mounted pack come from its mapping, without opening
+// anything; everything else is read from disk as before, so running without a pack needs no changes.
+class VirtualFileSystem {
+public:
+    static VirtualFileSystem& Instance() {
+        static VirtualFileSystem instance;
+        return instance;
+    }
+
+    // Mounts the pack at packPath over the directory it is in; packs mounted later take precedence.
+    // False if there is no valid pack there.
+    bool Mount(const std::string& packPath) {
+        std::shared_ptr<AssetPack> pack = AssetPack::Open(packPath);
+        if (!pack) {
+            return false;
+        }
+        std::string path = canonicalPath(packPath);
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Packs.push_back(Mounted{path.substr(0, path.find_last_of('/') + 1), std::move(pack)});
+        return true;
+    }
+
+    // the file at path, from a pack if one has it; an empty view if it exists nowhere
+    FileView Read(const std::string& path) const {
+        std::string name = canonicalPath(path);
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            for (auto mounted = m_Packs.rbegin(); mounted != m_Packs.rend(); ++mounted) {
+                if (name.compare(0, mounted->root.size(), mounted->root) == 0) {
+                    FileView view = AssetPack::Find(mounted->pack, name.substr(mounted->root.size()));
+                    if (view) {
+                        return view;
+                    }
+                }
+            }
+        }
+        return readFromDisk(name);
+    }
+
+    bool Exists(const std::string& path) const {
+        std::string name = canonicalPath(path);
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            for (const Mounted& mounted : m_Packs) {
+                if (name.compare(0, mounted.root.size(), mounted.root) == 0 &&
+                    mounted.pack->Contains(name.substr(mounted.root.size()))) {
+                    return true;
+                }
+            }
+        }
+        return access(name.c_str(), R_OK) == 0;
+    }
+
+private:
+    struct Mounted {
+        std::string root; // canonical, with a trailing '/'
+        std::shared_ptr<AssetPack> pack;
+    };
+
+    mutable std::mutex m_Mutex;
+    std::vector<Mounted> m_Packs;
+
+    VirtualFileSystem() = default;
+
+    static FileView readFromDisk(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            return FileView();
+        }
+        std::shared_ptr<std::vector<unsigned char>> buffer = std::make_shared<std::vector<unsigned char>>(
+                std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        FileView view;
+        view.data = buffer->data();
+        view.size = buffer->size();
+        view.owner = std::move(buffer);
+        return view;
+    }
+};
+
+}
+
+#endif //PROJECT_BASE_VIRTUALFILESYSTEM_H
@@ -1,2 +1,8 @@
+// decoded pixels go through the recycled staging buffers instead of plain malloc
+#include <rg/StagingMemory.h>
+#define STBI_MALLOC(size)           rg::staging::allocate(size)
+#define STBI_REALLOC(memory, size)  rg::staging::reallocate(memory, size)
+#define STBI_FREE(memory)           rg::staging::release(memory)
+
 #define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
\ No newline at end of file
+#include "stb_image.h"
@@ -6,18 +6,27 @@ in vec2 TexCoords;
 uniform sampler2D scene;
 uniform sampler2D bloomBlur;
 uniform bool bloom;
+uniform float bloomStrength;
 uniform float exposure;
+uniform bool autoExposure;
+uniform sampler2D adaptation; // 1x1, g: the exposure adapted to the scene
+// grading, tone curve and sRGB encoding, baked by ColorLut over log2 encoded coordinates
+uniform sampler3D colorLut;
+uniform float lutMinLog;
+uniform float lutOffset; // exp2(lutMinLog)
+uniform float lutLogRange;
+uniform float lutSize;
 
 void main()
 {             
-    const float gamma = 2.2;
     vec3 hdrColor = texture(scene, TexCoords).rgb;      
     vec3 bloomColor = texture(bloomBlur, TexCoords).rgb;
     if(bloom)
-        hdrColor += bloomColor; // additive blending
-    // tone mapping
-    vec3 result = vec3(1.0) - exp(-hdrColor * exposure);
-    // also gamma correct while we're at it       
-    result = pow(result, vec3(1.0 / gamma));
-    FragColor = vec4(result, 1.0);
-}
\ No newline at end of file
+        hdrColor += bloomColor * bloomStrength; // additive blending
+    float sceneExposure = autoExposure ? texelFetch(adaptation, ivec2(0), 0).g : exposure;
+    // tone mapping: to the LUT's coordinates, through the centers of its first and last texels
+    vec3 lutCoord = clamp((log2(hdrColor * sceneExposure + lutOffset) - lutMinLog) / lutLogRange, 0.0, 1.0);
+    lutCoord = lutCoord * ((lutSize - 1.0) / lutSize) + 0.5 / lutSize;
+    // already sRGB encoded, written as it is for the window and the upscaler alike
+    FragColor = vec4(texture(colorLut, lutCoord).rgb, 1.0);
+}
@@ -0,0 +1,42 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D scene;
+uniform float threshold;
+uniform float knee;
+uniform bool wide; // at a quarter of the scene's resolution, for half resolution bloom
+
+float luminance(vec3 color)
+{
+    return dot(color, vec3(0.2126, 0.7152, 0.0722));
+}
+
+// soft knee: quadratic from threshold - knee up to threshold + knee, linear above
+vec3 brightPart(vec3 color)
+{
+    float brightness = luminance(color);
+    float soft = clamp(brightness - threshold + knee, 0.0, 2.0 * knee);
+    soft = soft * soft / (4.0 * knee + 0.00001);
+    float contribution = max(soft, brightness - threshold) / max(brightness, 0.00001);
+    return color * contribution;
+}
+
+void main()
+{
+    // rendered at half resolution: each texel sits on the corner of 2x2 scene texels, so one
+    // bilinear fetch averages all four; at a quarter, four fetches average the 4x4 under it
+    vec3 color;
+    if (wide)
+    {
+        vec2 texel = 1.0 / textureSize(scene, 0);
+        color = 0.25 * (texture(scene, TexCoords + texel * vec2(-1.0, -1.0)).rgb +
+                        texture(scene, TexCoords + texel * vec2( 1.0, -1.0)).rgb +
+                        texture(scene, TexCoords + texel * vec2(-1.0,  1.0)).rgb +
+                        texture(scene, TexCoords + texel * vec2( 1.0,  1.0)).rgb);
+    }
+    else
+        color = texture(scene, TexCoords).rgb;
+    FragColor = vec4(brightPart(color), 1.0);
+}
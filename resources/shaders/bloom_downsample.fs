@@ -0,0 +1,71 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D source;
+uniform bool prefilter; // first level: read the HDR scene and keep only what is above the threshold
+uniform float threshold;
+uniform float knee;
+
+float luminance(vec3 color)
+{
+    return dot(color, vec3(0.2126, 0.7152, 0.0722));
+}
+
+// weights each group by 1 / (1 + luma) on the first level, so single very bright pixels don't flicker
+vec3 groupAverage(vec3 a, vec3 b, vec3 c, vec3 d)
+{
+    if (!prefilter)
+        return (a + b + c + d) * 0.25;
+    float wa = 1.0 / (1.0 + luminance(a));
+    float wb = 1.0 / (1.0 + luminance(b));
+    float wc = 1.0 / (1.0 + luminance(c));
+    float wd = 1.0 / (1.0 + luminance(d));
+    return (a * wa + b * wb + c * wc + d * wd) / (wa + wb + wc + wd);
+}
+
+// soft knee: quadratic from threshold - knee up to threshold + knee, linear above
+vec3 brightPart(vec3 color)
+{
+    float brightness = luminance(color);
+    float soft = clamp(brightness - threshold + knee, 0.0, 2.0 * knee);
+    soft = soft * soft / (4.0 * knee + 0.00001);
+    float contribution = max(soft, brightness - threshold) / max(brightness, 0.00001);
+    return color * contribution;
+}
+
+void main()
+{
+    // 13 bilinear taps around the center of the 4x4 source texels under this texel:
+    // a . b . c
+    // . j . k .
+    // d . e . f
+    // . l . m .
+    // g . h . i
+    vec2 texel = 1.0 / textureSize(source, 0);
+    vec3 a = texture(source, TexCoords + texel * vec2(-2.0,  2.0)).rgb;
+    vec3 b = texture(source, TexCoords + texel * vec2( 0.0,  2.0)).rgb;
+    vec3 c = texture(source, TexCoords + texel * vec2( 2.0,  2.0)).rgb;
+    vec3 d = texture(source, TexCoords + texel * vec2(-2.0,  0.0)).rgb;
+    vec3 e = texture(source, TexCoords).rgb;
+    vec3 f = texture(source, TexCoords + texel * vec2( 2.0,  0.0)).rgb;
+    vec3 g = texture(source, TexCoords + texel * vec2(-2.0, -2.0)).rgb;
+    vec3 h = texture(source, TexCoords + texel * vec2( 0.0, -2.0)).rgb;
+    vec3 i = texture(source, TexCoords + texel * vec2( 2.0, -2.0)).rgb;
+    vec3 j = texture(source, TexCoords + texel * vec2(-1.0,  1.0)).rgb;
+    vec3 k = texture(source, TexCoords + texel * vec2( 1.0,  1.0)).rgb;
+    vec3 l = texture(source, TexCoords + texel * vec2(-1.0, -1.0)).rgb;
+    vec3 m = texture(source, TexCoords + texel * vec2( 1.0, -1.0)).rgb;
+
+    // five overlapping 2x2 boxes: the inner one weighs half, the corner ones an eighth each
+    vec3 result = groupAverage(j, k, l, m) * 0.5;
+    result += groupAverage(a, b, d, e) * 0.125;
+    result += groupAverage(b, c, e, f) * 0.125;
+    result += groupAverage(d, e, g, h) * 0.125;
+    result += groupAverage(e, f, h, i) * 0.125;
+
+    if (prefilter)
+        result = brightPart(result);
+    FragColor = vec4(result, 1.0);
+}
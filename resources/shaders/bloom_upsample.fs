@@ -0,0 +1,23 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D source; // the next smaller level, added onto this one
+uniform float radius;     // in texels of source
+
+void main()
+{
+    // 3x3 tent: 1 2 1 / 2 4 2 / 1 2 1, over 16
+    vec2 offset = radius / textureSize(source, 0);
+    vec3 result = texture(source, TexCoords).rgb * 4.0;
+    result += (texture(source, TexCoords + vec2(-offset.x, 0.0)).rgb +
+               texture(source, TexCoords + vec2( offset.x, 0.0)).rgb +
+               texture(source, TexCoords + vec2(0.0, -offset.y)).rgb +
+               texture(source, TexCoords + vec2(0.0,  offset.y)).rgb) * 2.0;
+    result += texture(source, TexCoords + vec2(-offset.x, -offset.y)).rgb +
+              texture(source, TexCoords + vec2( offset.x, -offset.y)).rgb +
+              texture(source, TexCoords + vec2(-offset.x,  offset.y)).rgb +
+              texture(source, TexCoords + vec2( offset.x,  offset.y)).rgb;
+    FragColor = vec4(result / 16.0, 1.0);
+}
@@ -0,0 +1,48 @@
+#version 430 core
+// Separable Gaussian pass. Every work group blurs TILE pixels of one row (or column, when vertical):
+// it first loads them plus radius texels on either side into shared memory, then each invocation
+// reads its taps from there instead of fetching 2 * radius + 1 texels itself.
+#define TILE 128
+#define MAX_RADIUS 16
+
+layout(local_size_x = TILE) in;
+
+uniform sampler2D source;
+// the image format of the targets, defined by the program for packed float targets
+#ifndef DESTINATION_FORMAT
+#define DESTINATION_FORMAT rgba16f
+#endif
+layout(DESTINATION_FORMAT, binding = 0) uniform writeonly image2D destination;
+
+uniform bool horizontal;
+uniform int radius;
+uniform float weights[MAX_RADIUS + 1]; // [0] the center, then outwards
+
+shared vec3 tile[TILE + 2 * MAX_RADIUS];
+
+void main()
+{
+    ivec2 size = imageSize(destination);
+    ivec2 along = horizontal ? ivec2(1, 0) : ivec2(0, 1);
+    ivec2 across = ivec2(1, 1) - along;
+    int length = horizontal ? size.x : size.y;
+    int start = int(gl_WorkGroupID.x) * TILE;
+    int line = int(gl_WorkGroupID.y);
+
+    // tile and apron, clamped to the edge like the fragment path's sampler
+    for (int i = int(gl_LocalInvocationID.x); i < TILE + 2 * radius; i += TILE)
+    {
+        int position = clamp(start + i - radius, 0, length - 1);
+        tile[i] = texelFetch(source, along * position + across * line, 0).rgb;
+    }
+    barrier();
+
+    int position = start + int(gl_LocalInvocationID.x);
+    if (position >= length)
+        return;
+    int center = int(gl_LocalInvocationID.x) + radius;
+    vec3 result = tile[center] * weights[0];
+    for (int i = 1; i <= radius; ++i)
+        result += (tile[center - i] + tile[center + i]) * weights[i];
+    imageStore(destination, along * position + across * line, vec4(result, 1.0));
+}
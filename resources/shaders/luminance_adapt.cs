@@ -0,0 +1,62 @@
+#version 430 core
+// Turns the histogram luminance_histogram.cs filled into the average log2 luminance of the non-black
+// pixels, moves the adapted luminance towards it and stores that with the exposure that maps it to
+// middle grey. Clears the bins for the next frame on the way. One work group, one invocation per bin.
+#define BINS 256
+
+layout(local_size_x = BINS) in;
+
+layout(std430, binding = 0) buffer Histogram
+{
+    uint bins[BINS];
+};
+
+// r: adapted luminance, g: exposure
+layout(rg32f, binding = 0) uniform image2D adaptation;
+
+uniform float minLogLuminance;
+uniform float logRange;
+uniform float deltaTime;
+uniform float speedUp;   // adaptation rate per second towards brighter scenes
+uniform float speedDown; // and towards darker ones
+uniform float key;       // the luminance middle grey ends up at
+uniform float minExposure;
+uniform float maxExposure;
+
+shared float weightedBins[BINS];
+shared float counts[BINS];
+
+void main()
+{
+    uint bin = gl_LocalInvocationIndex;
+    float count = float(bins[bin]);
+    bins[bin] = 0u;
+    weightedBins[bin] = count * float(bin);
+    counts[bin] = bin == 0u ? 0.0 : count;
+    barrier();
+
+    for (uint stride = BINS / 2u; stride > 0u; stride >>= 1u)
+    {
+        if (bin < stride)
+        {
+            weightedBins[bin] += weightedBins[bin + stride];
+            counts[bin] += counts[bin + stride];
+        }
+        barrier();
+    }
+
+    if (bin != 0u)
+        return;
+    vec2 previous = imageLoad(adaptation, ivec2(0)).rg;
+    float luminance = previous.r;
+    if (counts[0] > 0.0)
+    {
+        float meanBin = weightedBins[0] / counts[0];
+        float target = exp2((meanBin - 1.0) / float(BINS - 2) * logRange + minLogLuminance);
+        float speed = target > luminance ? speedUp : speedDown;
+        // the first frame starts adapted
+        luminance = luminance <= 0.0 ? target : luminance + (target - luminance) * (1.0 - exp(-deltaTime * speed));
+    }
+    float exposure = clamp(key / max(luminance, 0.0001), minExposure, maxExposure);
+    imageStore(adaptation, ivec2(0), vec4(luminance, exposure, 0.0, 0.0));
+}
@@ -0,0 +1,31 @@
+#version 330 core
+out vec4 FragColor;
+
+// The fragment counterpart of luminance_adapt.cs, for a single pixel target: moves the adapted
+// luminance towards the log-average of the non-black pixels in the last mip level of logLuminance,
+// its weighted sum (r) over its weight (g). An all black scene leaves it where it is.
+
+uniform sampler2D logLuminance;
+uniform sampler2D previous; // r: adapted luminance, g: exposure
+uniform float lastLevel;
+uniform float deltaTime;
+uniform float speedUp;
+uniform float speedDown;
+uniform float key;
+uniform float minExposure;
+uniform float maxExposure;
+
+void main()
+{
+    vec2 average = textureLod(logLuminance, vec2(0.5), lastLevel).rg;
+    float luminance = texelFetch(previous, ivec2(0), 0).r;
+    if (average.g > 0.0)
+    {
+        float target = exp2(average.r / average.g);
+        float speed = target > luminance ? speedUp : speedDown;
+        // the first frame starts adapted
+        luminance = luminance <= 0.0 ? target : luminance + (target - luminance) * (1.0 - exp(-deltaTime * speed));
+    }
+    float exposure = clamp(key / max(luminance, 0.0001), minExposure, maxExposure);
+    FragColor = vec4(luminance, exposure, 0.0, 1.0);
+}
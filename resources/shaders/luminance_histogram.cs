@@ -0,0 +1,40 @@
+#version 430 core
+// Counts the scene's pixels into BINS bins by log2 luminance. Each work group counts its 16x16 pixels in
+// shared memory first, so the buffer only sees one atomic add per bin and group. Bin 0 holds black
+// pixels, which the average leaves out.
+#define BINS 256
+
+layout(local_size_x = 16, local_size_y = 16) in;
+
+uniform sampler2D scene;
+uniform float minLogLuminance;
+uniform float inverseLogRange; // 1 / (maxLogLuminance - minLogLuminance)
+
+layout(std430, binding = 0) buffer Histogram
+{
+    uint bins[BINS];
+};
+
+shared uint localBins[BINS];
+
+uint binOf(vec3 color)
+{
+    float luminance = dot(color, vec3(0.2126, 0.7152, 0.0722));
+    if (luminance < 0.0001)
+        return 0u;
+    float position = clamp((log2(luminance) - minLogLuminance) * inverseLogRange, 0.0, 1.0);
+    return uint(position * float(BINS - 2) + 1.0);
+}
+
+void main()
+{
+    localBins[gl_LocalInvocationIndex] = 0u;
+    barrier();
+
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    if (all(lessThan(texel, textureSize(scene, 0))))
+        atomicAdd(localBins[binOf(texelFetch(scene, texel, 0).rgb)], 1u);
+    barrier();
+
+    atomicAdd(bins[gl_LocalInvocationIndex], localBins[gl_LocalInvocationIndex]);
+}
@@ -0,0 +1,20 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+// log2 luminance of the scene, rendered into the top level of a mipmapped texture; glGenerateMipmap
+// then averages it down to the last level. Black pixels get a weight of 0 (g), as luminance_histogram.cs
+// leaves them out of its average too, so the log-average is the ratio r / g of the last level.
+
+uniform sampler2D scene;
+uniform float minLogLuminance;
+uniform float maxLogLuminance;
+
+void main()
+{
+    float luminance = dot(texture(scene, TexCoords).rgb, vec3(0.2126, 0.7152, 0.0722));
+    float weight = luminance < 0.0001 ? 0.0 : 1.0;
+    float logLuminance = clamp(log2(max(luminance, 0.0001)), minLogLuminance, maxLogLuminance);
+    FragColor = vec4(logLuminance * weight, weight, 0.0, 1.0);
+}
@@ -0,0 +1,128 @@
+#version 330 core
+out vec4 FragColor;
+
+// Edge adaptive spatial upsampling, after EASU from AMD FidelityFX Super Resolution 1.0: a 12-tap
+// Lanczos-like kernel stretched along the local edge direction, found from the luma of the 2x2 texels
+// around the sample. The 3.3 core profile has no textureGather, so the taps are fetched one by one.
+// Works on tone mapped colors in sRGB encoding, as the composite writes them for the upscaler.
+
+uniform sampler2D image;
+uniform vec2 scale; // input size / output size
+
+vec3 fetch(ivec2 texel)
+{
+    ivec2 size = textureSize(image, 0);
+    return texelFetch(image, clamp(texel, ivec2(0), size - 1), 0).rgb;
+}
+
+// luma times two, all that the edge analysis needs
+float luma(vec3 color)
+{
+    return color.b * 0.5 + (color.r * 0.5 + color.g);
+}
+
+// Direction and length of the edge at one of the four texels f g j k around the sample, from the cross
+//   a
+// b c d
+//   e
+// weighted by the bilinear weight w of that texel.
+void accumulateEdge(inout vec2 dir, inout float len, float w, float a, float b, float c, float d, float e)
+{
+    float dc = d - c;
+    float cb = c - b;
+    float dirX = d - b;
+    float lenX = clamp(abs(dirX) / max(max(abs(dc), abs(cb)), 1.0 / 65536.0), 0.0, 1.0);
+    dir.x += dirX * w;
+    len += lenX * lenX * w;
+
+    float ec = e - c;
+    float ca = c - a;
+    float dirY = e - a;
+    float lenY = clamp(abs(dirY) / max(max(abs(ec), abs(ca)), 1.0 / 65536.0), 0.0, 1.0);
+    dir.y += dirY * w;
+    len += lenY * lenY * w;
+}
+
+// one tap of the kernel at offset from the sample, rotated into the edge's frame and scaled by len
+void accumulateTap(inout vec3 color, inout float weight, vec2 offset, vec2 dir, vec2 len, float lob, float clp, vec3 c)
+{
+    vec2 v = vec2(offset.x * dir.x + offset.y * dir.y, offset.x * -dir.y + offset.y * dir.x) * len;
+    float d2 = min(dot(v, v), clp);
+    // windowed approximation of Lanczos 2: (25/16 (2/5 x^2 - 1)^2 - (25/16 - 1)) (lob x^2 - 1)^2
+    float wB = 2.0 / 5.0 * d2 - 1.0;
+    float wA = lob * d2 - 1.0;
+    wB *= wB;
+    wA *= wA;
+    wB = 25.0 / 16.0 * wB - (25.0 / 16.0 - 1.0);
+    float w = wB * wA;
+    color += c * w;
+    weight += w;
+}
+
+void main()
+{
+    // position in input texels, relative to the center of texel f
+    vec2 pp = gl_FragCoord.xy * scale - 0.5;
+    vec2 fp = floor(pp);
+    pp -= fp;
+    ivec2 f = ivec2(fp);
+
+    //   b c
+    // e f g h
+    // i j k l
+    //   n o
+    vec3 bC = fetch(f + ivec2(0, -1));
+    vec3 cC = fetch(f + ivec2(1, -1));
+    vec3 eC = fetch(f + ivec2(-1, 0));
+    vec3 fC = fetch(f);
+    vec3 gC = fetch(f + ivec2(1, 0));
+    vec3 hC = fetch(f + ivec2(2, 0));
+    vec3 iC = fetch(f + ivec2(-1, 1));
+    vec3 jC = fetch(f + ivec2(0, 1));
+    vec3 kC = fetch(f + ivec2(1, 1));
+    vec3 lC = fetch(f + ivec2(2, 1));
+    vec3 nC = fetch(f + ivec2(0, 2));
+    vec3 oC = fetch(f + ivec2(1, 2));
+    float bL = luma(bC), cL = luma(cC), eL = luma(eC), fL = luma(fC), gL = luma(gC), hL = luma(hC);
+    float iL = luma(iC), jL = luma(jC), kL = luma(kC), lL = luma(lC), nL = luma(nC), oL = luma(oC);
+
+    vec2 dir = vec2(0.0);
+    float len = 0.0;
+    accumulateEdge(dir, len, (1.0 - pp.x) * (1.0 - pp.y), bL, eL, fL, gL, jL);
+    accumulateEdge(dir, len, pp.x * (1.0 - pp.y), cL, fL, gL, hL, kL);
+    accumulateEdge(dir, len, (1.0 - pp.x) * pp.y, fL, iL, jL, kL, nL);
+    accumulateEdge(dir, len, pp.x * pp.y, gL, jL, kL, lL, oL);
+
+    // normalized direction, along x where there is no edge
+    float dirR = dot(dir, dir);
+    bool noEdge = dirR < 1.0 / 32768.0;
+    dir = noEdge ? vec2(1.0, 0.0) : dir * inversesqrt(dirR);
+
+    // stretch the kernel along the edge and shrink it across, the more the stronger the edge
+    len = len * 0.5;
+    len *= len;
+    float stretch = dot(dir, dir) / max(abs(dir.x), abs(dir.y));
+    vec2 len2 = vec2(1.0 + (stretch - 1.0) * len, 1.0 - 0.5 * len);
+    float lob = 0.5 + ((1.0 / 4.0 - 0.04) - 0.5) * len;
+    float clp = 1.0 / lob;
+
+    vec3 color = vec3(0.0);
+    float weight = 0.0;
+    accumulateTap(color, weight, vec2(0.0, -1.0) - pp, dir, len2, lob, clp, bC);
+    accumulateTap(color, weight, vec2(1.0, -1.0) - pp, dir, len2, lob, clp, cC);
+    accumulateTap(color, weight, vec2(-1.0, 1.0) - pp, dir, len2, lob, clp, iC);
+    accumulateTap(color, weight, vec2(0.0, 1.0) - pp, dir, len2, lob, clp, jC);
+    accumulateTap(color, weight, vec2(0.0, 0.0) - pp, dir, len2, lob, clp, fC);
+    accumulateTap(color, weight, vec2(-1.0, 0.0) - pp, dir, len2, lob, clp, eC);
+    accumulateTap(color, weight, vec2(1.0, 1.0) - pp, dir, len2, lob, clp, kC);
+    accumulateTap(color, weight, vec2(2.0, 1.0) - pp, dir, len2, lob, clp, lC);
+    accumulateTap(color, weight, vec2(2.0, 0.0) - pp, dir, len2, lob, clp, hC);
+    accumulateTap(color, weight, vec2(1.0, 0.0) - pp, dir, len2, lob, clp, gC);
+    accumulateTap(color, weight, vec2(1.0, 2.0) - pp, dir, len2, lob, clp, oC);
+    accumulateTap(color, weight, vec2(0.0, 2.0) - pp, dir, len2, lob, clp, nC);
+
+    // the negative lobes ring; clamp to the 2x2 texels around the sample
+    vec3 min4 = min(min(fC, gC), min(jC, kC));
+    vec3 max4 = max(max(fC, gC), max(jC, kC));
+    FragColor = vec4(clamp(color / weight, min4, max4), 1.0);
+}
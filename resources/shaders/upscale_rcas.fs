@@ -0,0 +1,54 @@
+#version 330 core
+out vec4 FragColor;
+
+// Robust contrast adaptive sharpening, after RCAS from AMD FidelityFX Super Resolution 1.0: a 5-tap
+// cross whose negative lobe is as strong as it can be without taking any channel of the center out of
+// the range of its neighbours, so it doesn't ring. Damped on single pixel noise. Reads and writes colors
+// in sRGB encoding, so the result goes to the window with GL_FRAMEBUFFER_SRGB off.
+
+uniform sampler2D image;
+uniform float sharpness; // 1 is the strongest, each halving one stop less
+
+// the lobe limit of the 5-tap cross, 0.25 - 1/16
+const float LOBE_LIMIT = 0.1875;
+
+vec3 fetch(ivec2 texel)
+{
+    ivec2 size = textureSize(image, 0);
+    return texelFetch(image, clamp(texel, ivec2(0), size - 1), 0).rgb;
+}
+
+float luma(vec3 color)
+{
+    return color.b * 0.5 + (color.r * 0.5 + color.g);
+}
+
+void main()
+{
+    //   b
+    // d e f
+    //   h
+    ivec2 center = ivec2(gl_FragCoord.xy);
+    vec3 b = fetch(center + ivec2(0, -1));
+    vec3 d = fetch(center + ivec2(-1, 0));
+    vec3 e = fetch(center);
+    vec3 f = fetch(center + ivec2(1, 0));
+    vec3 h = fetch(center + ivec2(0, 1));
+
+    // noise: the center far from the average of the cross, relative to its range
+    float bL = luma(b), dL = luma(d), eL = luma(e), fL = luma(f), hL = luma(h);
+    float range = max(max(max(bL, dL), max(eL, fL)), hL) - min(min(min(bL, dL), min(eL, fL)), hL);
+    float noise = clamp(abs(0.25 * (bL + dL + fL + hL) - eL) / max(range, 1.0 / 65536.0), 0.0, 1.0);
+    noise = -0.5 * noise + 1.0;
+
+    // the most negative lobe that keeps every channel of the result between 0 and 1 of its range
+    vec3 min4 = min(min(b, d), min(f, h));
+    vec3 max4 = max(max(b, d), max(f, h));
+    vec3 hitMin = min(min4, e) / max(4.0 * max4, 1.0 / 65536.0);
+    vec3 hitMax = (1.0 - max(max4, e)) / min(4.0 * min4 - 4.0, -1.0 / 65536.0);
+    vec3 lobeRGB = max(-hitMin, hitMax);
+    float lobe = max(-LOBE_LIMIT, min(max(max(lobeRGB.r, lobeRGB.g), lobeRGB.b), 0.0)) * sharpness;
+    lobe *= noise;
+
+    FragColor = vec4((lobe * (b + d + f + h) + e) / (4.0 * lobe + 1.0), 1.0);
+}
@@ -13,6 +13,25 @@
 #include <learnopengl/shader.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
+#include <rg/RenderQueue.h>
+#include <rg/GLResource.h>
+#include <rg/ThreadPool.h>
+#include <rg/AsyncLoader.h>
+#include <rg/Image.h>
+#include <rg/ImageDecoder.h>
+#include <rg/StagingMemory.h>
+#include <rg/UploadScheduler.h>
+#include <rg/TextureCache.h>
+#include <rg/TextureResidency.h>
+#include <rg/VirtualFileSystem.h>
+#include <rg/Bloom.h>
+#include <rg/RenderTargets.h>
+#include <rg/GpuTimer.h>
+#include <rg/FrameGovernor.h>
+#include <rg/Upscaler.h>
+#include <rg/RenderGraph.h>
+#include <rg/AutoExposure.h>
+#include <rg/ColorLut.h>
 
 #include <iostream>
 
@@ -26,18 +45,20 @@ void processInput(GLFWwindow *window);
 
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods);
 
-unsigned int loadCubemap(vector<std::string> faces);
+unsigned int createPlaceholderTexture(GLenum target);
 
-unsigned int loadTexture(char const * path);
+void uploadCubemap(rg::UploadScheduler& uploads, rg::CachedTexture& cubemap, const vector<rg::TextureSource>& faces, const vector<std::string>& paths);
+
+void uploadTexture(rg::UploadScheduler& uploads, rg::CachedTexture& texture, const rg::TextureSource& source, const std::string& path);
 
 void renderQuad();
 
-void renderCube();
+unsigned int getCubeVAO();
 
 // settings
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
-float exposure = 0.5f;
+float exposure = 0.5f; // with auto exposure off
 bool bloom = true;
 bool bloomKeyPressed = false;
 
@@ -71,6 +92,28 @@ struct ProgramState {
     float cowHeight = -0.7f;
     bool CameraMouseMovementUpdateEnabled = true;
     PointLight pointLight;
+    int textureBudgetMB = 256; // VRAM the material textures may keep resident
+    rg::BloomMode bloomMode = rg::BloomMode::MipChain;
+    float bloomThreshold = 1.0f;
+    float bloomKnee = 0.5f;
+    int bloomLevels = 6;
+    float bloomRadius = 1.0f;
+    bool computeBlur = true; // Gaussian passes as compute shaders, when the GL version has them
+    bool autoExposure = true; // adapt the exposure to the scene's brightness instead of the fixed one
+    float exposureCompensation = 0.0f; // stops above middle grey
+    float adaptSpeedUp = 3.0f; // per second, towards brighter scenes
+    float adaptSpeedDown = 1.0f; // per second, towards darker scenes
+    bool computeHistogram = true; // measure with a compute shader histogram, when the GL version has them
+    rg::ColorGrading grading; // baked into the composite's LUT with the tone curve
+    int blurRadius = 4;
+    int blurPasses = 10;
+    float renderScale = 1.0f; // scene resolution relative to the window
+    bool upscaler = true; // FSR 1 style upscaling below the window's resolution, bilinear otherwise
+    float sharpness = 0.25f; // stops below the upscaler's strongest sharpening
+    float vegetationDistance = 40.0f;
+    rg::FormatProfile formatProfile = rg::FormatProfile::Balanced; // formats of the scene and bloom targets
+    bool governor = true; // trade the settings above for frame time when the GPU can't keep up
+    float frameTimeTarget = 16.6f; // GPU milliseconds per frame
     ProgramState()
             : camera(glm::vec3(0.0f, -0.7f, 3.0f)) {}
 
@@ -110,13 +153,21 @@ void ProgramState::LoadFromFile(std::string filename) {
 }
 
 ProgramState *programState;
+// the scene framebuffer, which follows the window's size
+rg::RenderTargets *renderTargets = nullptr;
 
-void DrawImGui(ProgramState *programState);
+void DrawImGui(ProgramState *programState, const rg::TextureResidency &residency, const rg::Bloom &bloomPass,
+               const rg::AutoExposure &autoExposure, const rg::FrameGovernor &governor,
+               const rg::QualitySettings &quality, const rg::RenderGraph &frameGraph);
 
 int main() {
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
+    // terminates glfw when main returns, after every GL object declared below has been released
+    struct GlfwTerminator {
+        ~GlfwTerminator() { glfwTerminate(); }
+    } glfwTerminator;
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -130,7 +181,6 @@ int main() {
     GLFWwindow *window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
     if (window == NULL) {
         std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
         return -1;
     }
     glfwMakeContextCurrent(window);
@@ -147,6 +197,14 @@ int main() {
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    // baked .dds textures are only used when the driver can sample their format
+    rg::detectBlockFormats();
+    // compute shaders are GL 4.3, past the 3.3 glad loads; without them the fragment paths are used
+    rg::loadComputeFunctions((GLADloadproc) glfwGetProcAddress);
+    // with a resources.pack (tools/asset_packer) every asset below is read from it instead of loose files
+    if (rg::VirtualFileSystem::Instance().Mount(FileSystem::getPath("resources.pack"))) {
+        std::cout << "Reading assets from resources.pack" << std::endl;
+    }
 
     // tell stb_image.h to flip loaded texture's on the y-axis (before loading model).
     // stbi_set_flip_vertically_on_load(true);
@@ -177,10 +235,19 @@ int main() {
     Shader objectShader("resources/shaders/object.vs", "resources/shaders/object.fs");
     Shader skyboxShader("resources/shaders/skybox.vs", "resources/shaders/skybox.fs");
     Shader blendingShader("resources/shaders/blending.vs", "resources/shaders/blending.fs");
-    Shader blurShader("resources/shaders/blur.vs", "resources/shaders/blur.fs");
     Shader bloomShader("resources/shaders/bloom.vs", "resources/shaders/bloom.fs");
     Shader lightboxShader("resources/shaders/object.vs", "resources/shaders/lightbox.fs");
 
+    // background loading: files are read and decoded on the workers, the render loop uploads whatever
+    // is ready between frames, so the window is responsive right away and assets pop in as they finish
+    rg::ThreadPool workers;
+    rg::AsyncLoader loader(workers);
+    rg::ImageDecoder imageDecoder(workers);
+    // everything that reaches the GPU after startup is streamed through here, a few MB per frame at most
+    rg::UploadScheduler uploads;
+    // model textures keep only the mip levels their on-screen size needs, within the budget
+    rg::TextureResidency residency(workers, uploads, programState->textureBudgetMB * size_t(1024 * 1024));
+
     float skyboxVertices[] = {
             // positions
             -1.0f,  1.0f, -1.0f,
@@ -238,9 +305,8 @@ int main() {
     };
 
     // skybox VAO
-    unsigned int skyboxVAO, skyboxVBO;
-    glGenVertexArrays(1, &skyboxVAO);
-    glGenBuffers(1, &skyboxVBO);
+    rg::GLVertexArray skyboxVAO = rg::GLVertexArray::create();
+    rg::GLBuffer skyboxVBO = rg::GLBuffer::create();
     glBindVertexArray(skyboxVAO);
     glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
@@ -256,14 +322,20 @@ int main() {
                     FileSystem::getPath("resources/textures/skybox/front.jpg"),
                     FileSystem::getPath("resources/textures/skybox/back.jpg")
             };
-    unsigned int cubemapTexture = loadCubemap(faces);
+    // the skybox is black until its faces are decoded
+    rg::GLTexture cubemapPlaceholder(createPlaceholderTexture(GL_TEXTURE_CUBE_MAP));
+    rg::CachedTexture cubemapTexture;
+    // one decode job per face, uploaded together once all six are done
+    loader.Await(imageDecoder.Decode(faces, rg::TextureVariant::CubeFace),
+                 [&uploads, &cubemapTexture, faces](vector<rg::TextureSource> sources) {
+                     uploadCubemap(uploads, cubemapTexture, sources, faces);
+                 });
     skyboxShader.use();
     skyboxShader.setInt("skybox", 0);
 
     // transparent VAO
-    unsigned int transparentVAO, transparentVBO;
-    glGenVertexArrays(1, &transparentVAO);
-    glGenBuffers(1, &transparentVBO);
+    rg::GLVertexArray transparentVAO = rg::GLVertexArray::create();
+    rg::GLBuffer transparentVBO = rg::GLBuffer::create();
     glBindVertexArray(transparentVAO);
     glBindBuffer(GL_ARRAY_BUFFER, transparentVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(transparentVertices), transparentVertices, GL_STATIC_DRAW);
@@ -275,7 +347,14 @@ int main() {
     glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(5 * sizeof(float)));
 
     glBindVertexArray(0);
-    unsigned int transparentTexture = loadTexture(FileSystem::getPath("resources/textures/Corn.png").c_str());
+    // the corn is fully transparent (discarded) until Corn.png is decoded
+    rg::GLTexture transparentPlaceholder(createPlaceholderTexture(GL_TEXTURE_2D));
+    rg::CachedTexture transparentTexture;
+    std::string cornPath = FileSystem::getPath("resources/textures/Corn.png");
+    loader.Await(imageDecoder.Decode(cornPath, rg::TextureVariant::Sprite),
+                 [&uploads, &transparentTexture, cornPath](rg::TextureSource source) {
+                     uploadTexture(uploads, transparentTexture, source, cornPath);
+                 });
 
     vector<glm::vec3> vegetation
             {
@@ -363,75 +442,55 @@ int main() {
 
     // load models
     // -----------
-    Model UFOModel("resources/objects/UFO_Saucer/UFO_Saucer.obj");
-    UFOModel.SetShaderTextureNamePrefix("material.");
-    Model FieldModel("resources/objects/Field/Field.obj");
-    FieldModel.SetShaderTextureNamePrefix("material.");
-    Model CowModel("resources/objects/Cow/Cow.obj");
-    CowModel.SetShaderTextureNamePrefix("material.");
-    Model TruckModel("resources/objects/Truck/Truck.obj");
-    TruckModel.SetShaderTextureNamePrefix("material.");
-    Model FireModel("resources/objects/Fire/Fire.obj");
-    FireModel.SetShaderTextureNamePrefix("material.");
-
-    // configure (floating point) framebuffers
+    // all files are imported at once on the worker pool (meshes and textures converted in parallel too);
+    // a model is drawn from the first frame after all of its buffers and textures have been streamed in
+    std::unique_ptr<Model> UFOModel, FieldModel, CowModel, TruckModel, FireModel;
+    // models are only drawn with objectShader, so only the maps it samples are loaded
+    TextureUsage objectTextures = TextureUsage::FromShader(objectShader, "material.");
+    auto loadModel = [&workers, &loader, &uploads, &residency, objectTextures](const char* path, std::unique_ptr<Model>& model) {
+        loader.Load([&workers, path, objectTextures] { return Model::LoadData(path, &workers, objectTextures); },
+                    [&uploads, &residency, &model](ModelData data) {
+                        // the vertex data is handed to the scheduler, nothing reads it back afterwards
+                        std::shared_ptr<Model> streamed = std::make_shared<Model>(std::move(data), false, &uploads, &residency);
+                        streamed->SetShaderTextureNamePrefix("material.");
+                        uploads.Then([&model, streamed] { model.reset(new Model(std::move(*streamed))); });
+                    });
+    };
+    loadModel("resources/objects/UFO_Saucer/UFO_Saucer.obj", UFOModel);
+    loadModel("resources/objects/Field/Field.obj", FieldModel);
+    loadModel("resources/objects/Cow/Cow.obj", CowModel);
+    loadModel("resources/objects/Truck/Truck.obj", TruckModel);
+    loadModel("resources/objects/Fire/Fire.obj", FireModel);
+
+    // configure the floating point framebuffer, sized to the window; the bloom pass finds the
+    // bright parts in its color buffer
     // ---------------------------------------
-    unsigned int hdrFBO;
-    glGenFramebuffers(1, &hdrFBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
-    // create 2 floating point color buffers (1 for normal rendering, other for brightness threshold values)
-    unsigned int colorBuffers[2];
-    glGenTextures(2, colorBuffers);
-    for (unsigned int i = 0; i < 2; i++)
-    {
-        glBindTexture(GL_TEXTURE_2D, colorBuffers[i]);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE); // we clamp to the edge as the blur filter would otherwise sample repeated texture values!
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        // attach texture to framebuffer
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, colorBuffers[i], 0);
-    }
-    // create and attach depth buffer (renderbuffer)
-    unsigned int rboDepth;
-    glGenRenderbuffers(1, &rboDepth);
-    glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, SCR_WIDTH, SCR_HEIGHT);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepth);
-    // tell OpenGL which color attachments we'll use (of this framebuffer) for rendering
-    unsigned int attachments[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
-    glDrawBuffers(2, attachments);
-    // finally check if framebuffer is complete
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "Framebuffer not complete!" << std::endl;
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-    // ping-pong-framebuffer for blurring
-    unsigned int pingpongFBO[2];
-    unsigned int pingpongColorbuffers[2];
-    glGenFramebuffers(2, pingpongFBO);
-    glGenTextures(2, pingpongColorbuffers);
-    for (unsigned int i = 0; i < 2; i++)
-    {
-        glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[i]);
-        glBindTexture(GL_TEXTURE_2D, pingpongColorbuffers[i]);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE); // we clamp to the edge as the blur filter would otherwise sample repeated texture values!
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pingpongColorbuffers[i], 0);
-        // also check if framebuffers are complete (no need for depth buffer)
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-            std::cout << "Framebuffer not complete!" << std::endl;
-    }
+    int framebufferWidth, framebufferHeight;
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    rg::RenderTargets sceneTargets(framebufferWidth, framebufferHeight, rg::targetFormats(programState->formatProfile));
+    renderTargets = &sceneTargets;
+
+    // blurs the bright parts of the scene for the composite
+    rg::Bloom bloomPass(renderQuad);
+    bloomPass.Resize(sceneTargets.Width(), sceneTargets.Height());
+
+    // measures the scene's brightness and adapts the composite's exposure to it, all on the GPU
+    rg::AutoExposure autoExposure(renderQuad);
+
+    // the composite's tone curve, sRGB encoding and grading as one 3D texture lookup
+    rg::ColorLut colorLut;
+
+    // brings scenes rendered below the window's resolution up to it
+    rg::Upscaler upscaler(renderQuad);
+    // declares each frame's passes after the scene's draws have been queued
+    rg::RenderGraph frameGraph;
 
-    blurShader.use();
-    blurShader.setInt("image", 0);
     bloomShader.use();
     bloomShader.setInt("scene", 0);
     bloomShader.setInt("bloomBlur", 1);
+    bloomShader.setInt("adaptation", 2);
+    bloomShader.setInt("colorLut", 3);
+    rg::ColorLut::SetUniforms(bloomShader);
 
     // load lights
     PointLight& pointLight = programState->pointLight;
@@ -454,6 +513,13 @@ int main() {
     lightColors.push_back(glm::vec3(213.0f, 100.0f, 23.0f));
     lightColors.push_back(glm::vec3(10.0f, 10.0f, 10.0f));
 
+    rg::RenderQueue renderQueue;
+    renderQueue.SetResidency(&residency);
+
+    // lowers the quality settings while the GPU takes longer than the target per frame
+    rg::GpuTimer gpuTimer;
+    rg::FrameGovernor governor;
+
     // draw in wireframe
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
@@ -470,14 +536,42 @@ int main() {
         // -----
         processInput(window);
 
+        // upload whatever finished loading in the background, within this frame's upload budget
+        if (!loader.Done() || !uploads.Idle()) {
+            loader.Update();
+            uploads.Update();
+            // startup loading is over, give the recycled decode buffers back
+            if (loader.Done() && uploads.Idle())
+                rg::staging::trim();
+        }
+
+        // pick this frame's quality from the GPU times that have come in
+        float gpuTime;
+        if (gpuTimer.Collect(gpuTime))
+            governor.Update(gpuTime, currentFrame);
+        governor.SetEnabled(programState->governor);
+        governor.SetTarget(programState->frameTimeTarget);
+        rg::QualitySettings requested;
+        requested.renderScale = programState->renderScale;
+        requested.bloomLevels = programState->bloomLevels;
+        requested.blurPasses = programState->blurPasses;
+        requested.vegetationDistance = programState->vegetationDistance;
+        rg::QualitySettings quality = governor.Apply(requested);
+
         // render
         // ------
+        gpuTimer.Begin();
+        // the passes clear their own targets with it; the composite covers the whole window
         glClearColor(programState->clearColor.r, programState->clearColor.g, programState->clearColor.b, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // HDR
-        glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        // HDR, reallocated once a new window size or render scale has settled
+        rg::TargetFormats formats = rg::targetFormats(programState->formatProfile);
+        sceneTargets.SetRenderScale(quality.renderScale);
+        sceneTargets.SetFormats(formats.color, formats.depth);
+        sceneTargets.Update(currentFrame);
+        bloomPass.Resize(sceneTargets.Width(), sceneTargets.Height());
+        bloomPass.SetFormat(formats.color);
+        bloomPass.SetHalfResolution(formats.halfResolutionBloom);
 
         // don't forget to enable shader before setting uniforms
         objectShader.use();
@@ -538,11 +632,14 @@ int main() {
 
         // view/projection transformations
         glm::mat4 projection = glm::perspective(glm::radians(programState->camera.Zoom),
-                                                (float) SCR_WIDTH / (float) SCR_HEIGHT, 0.1f, 100.0f);
+                                                sceneTargets.Aspect(), 0.1f, 100.0f);
         glm::mat4 view = programState->camera.GetViewMatrix();
         objectShader.setMat4("projection", projection);
         objectShader.setMat4("view", view);
 
+        renderQueue.Begin(programState->camera.Position, 100.0f);
+        residency.Begin(programState->camera.Position, projection, sceneTargets.Height());
+
         // render the loaded UFO model
         glm::mat4 model = glm::mat4(1.0f);
         model = glm::translate(model,glm::vec3(-6.0f, 1.0f, 4.0f));
@@ -550,30 +647,30 @@ int main() {
         model = glm::rotate(model,glm::radians(90.0f),glm::vec3(0,0,1));
         model = glm::rotate(model,glm::radians(90.0f),glm::vec3(0,1,0));
         model = glm::scale(model, glm::vec3(0.01f));
-        objectShader.setMat4("model", model);
-        UFOModel.Draw(objectShader);
+        if (UFOModel)
+            renderQueue.Submit(*UFOModel, objectShader, model);
 
         // render the loaded Field model
         model = glm::mat4(1.0f);
         model = glm::scale(model, glm::vec3(0.3f));
-        objectShader.setMat4("model", model);
-        FieldModel.Draw(objectShader);
+        if (FieldModel)
+            renderQueue.Submit(*FieldModel, objectShader, model);
 
         // render the loaded Cow model (cow to be abducted)
         if(!programState->abduct) {
             model = glm::mat4(1.0f);
             model = glm::translate(model,glm::vec3(-6.0f, -0.7f, 4.0f));
             model = glm::scale(model, glm::vec3(0.005f));
-            objectShader.setMat4("model", model);
-            CowModel.Draw(objectShader);
+            if (CowModel)
+                renderQueue.Submit(*CowModel, objectShader, model);
         }
         else if(programState->cowHeight < 1.3f){
             programState->cowHeight += 0.02f;
             model = glm::mat4(1.0f);
             model = glm::translate(model,glm::vec3(-6.0f, programState->cowHeight, 4.0f));
             model = glm::scale(model, glm::vec3(0.005f));
-            objectShader.setMat4("model", model);
-            CowModel.Draw(objectShader);
+            if (CowModel)
+                renderQueue.Submit(*CowModel, objectShader, model);
         }
 
         //render the regular cows
@@ -582,8 +679,8 @@ int main() {
             model = glm::mat4(1.0f);
             model = glm::translate(model, cows[i]);
             model = glm::scale(model, glm::vec3(0.005f));
-            objectShader.setMat4("model", model);
-            CowModel.Draw(objectShader);
+            if (CowModel)
+                renderQueue.Submit(*CowModel, objectShader, model);
         }
 
         //render the vehicle
@@ -593,16 +690,16 @@ int main() {
         model = glm::rotate(model,glm::radians(-5.0f),glm::vec3(0,0,1));
         model = glm::rotate(model,glm::radians(-15.0f),glm::vec3(1,0,0));
         model = glm::scale(model, glm::vec3(0.03f));
-        objectShader.setMat4("model", model);
-        TruckModel.Draw(objectShader);
+        if (TruckModel)
+            renderQueue.Submit(*TruckModel, objectShader, model);
 
         //render the fire
         model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(7.0f, -0.65f, 3.0f));
         model = glm::rotate(model, glm::radians(-5.0f),glm::vec3(1,0,1));
         model = glm::scale(model, glm::vec3(0.6f));
-        objectShader.setMat4("model", model);
-        FireModel.Draw(objectShader);
+        if (FireModel)
+            renderQueue.Submit(*FireModel, objectShader, model);
 
         // finally show all the light sources as bright cubes
         lightboxShader.use();
@@ -614,13 +711,10 @@ int main() {
             glm::mat4 model = glm::mat4(1.0f);
             model = glm::translate(model, glm::vec3(lightPositions[i]));
             model = glm::scale(model, glm::vec3(0.1f));
-            lightboxShader.setMat4("model", model);
-            lightboxShader.setVec3("lightColor", lightColors[i]);
-            renderCube();
+            renderQueue.Submit(getCubeVAO(), 36, lightboxShader, model, lightColors[i]);
         }
 
         // vegetation
-        glDisable(GL_CULL_FACE);
         blendingShader.use();
 
         // Directional light for objects
@@ -681,65 +775,129 @@ int main() {
         blendingShader.setMat4("view", view);
         blendingShader.setMat4("projection", projection);
 
-        glBindVertexArray(transparentVAO);
-        glBindTexture(GL_TEXTURE_2D, transparentTexture);
         for (unsigned int i = 0; i < vegetation.size(); i++)
         {
+            if (glm::distance(vegetation[i], programState->camera.Position) > quality.vegetationDistance)
+                continue;
             model = glm::mat4(1.0f);
             model = glm::translate(model, vegetation[i]);
             //model = glm::scale(model, glm::vec3(0.5f));
-            blendingShader.setMat4("model", model);
-            glDrawArrays(GL_TRIANGLES, 0, 6);
+            renderQueue.Submit(transparentVAO, 6, transparentTexture ? transparentTexture.get() : transparentPlaceholder.get(), GL_TEXTURE_2D, blendingShader, model,
+                               rg::RenderLayer::Transparent);
         }
 
-        glEnable(GL_CULL_FACE);
-
-        // draw skybox as last
-        glDepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
+        // skybox is sorted behind the opaque geometry
         skyboxShader.use();
         view = glm::mat4(glm::mat3(programState->camera.GetViewMatrix())); // remove translation from the view matrix
         skyboxShader.setMat4("view", view);
         skyboxShader.setMat4("projection", projection);
-
-        // skybox cube
-        glBindVertexArray(skyboxVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
-        glDepthFunc(GL_LESS); // set depth function back to default
-
-        // 2. blur bright fragments with two-pass Gaussian Blur
-        // --------------------------------------------------
-        bool horizontal = true, first_iteration = true;
-        unsigned int amount = 10;
-        blurShader.use();
-        for (unsigned int i = 0; i < amount; i++)
-        {
-            glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[horizontal]);
-            blurShader.setInt("horizontal", horizontal);
-            glBindTexture(GL_TEXTURE_2D, first_iteration ? colorBuffers[1] : pingpongColorbuffers[!horizontal]); // bind texture of other framebuffer (or scene if first iteration)
+        renderQueue.SubmitBackground(skyboxVAO, 36, cubemapTexture ? cubemapTexture.get() : cubemapPlaceholder.get(),
+                                     GL_TEXTURE_CUBE_MAP, skyboxShader);
+
+        residency.SetBudget(programState->textureBudgetMB * size_t(1024 * 1024));
+        residency.SetMipBias(quality.mipBias);
+        bloomPass.SetMode(programState->bloomMode);
+        bloomPass.SetThreshold(programState->bloomThreshold, programState->bloomKnee);
+        bloomPass.SetLevelCount(quality.bloomLevels);
+        bloomPass.SetRadius(programState->bloomRadius);
+        bloomPass.SetComputeBlur(programState->computeBlur);
+        bloomPass.SetBlurRadius(programState->blurRadius);
+        bloomPass.SetBlurPasses(quality.blurPasses);
+        autoExposure.SetCompensation(programState->exposureCompensation);
+        autoExposure.SetSpeed(programState->adaptSpeedUp, programState->adaptSpeedDown);
+        autoExposure.SetComputeHistogram(programState->computeHistogram);
+        colorLut.SetGrading(programState->grading);
+        upscaler.SetEnabled(programState->upscaler);
+        upscaler.SetSharpness(programState->sharpness);
+        bool upscale = upscaler.Active(sceneTargets.Width(), sceneTargets.Height(),
+                                       sceneTargets.WindowWidth(), sceneTargets.WindowHeight());
+
+        // the rest of the frame as a render graph; the graph binds each pass's target, and culls the passes
+        // nothing uses: the bloom when it's switched off, the upscaler's when the scene isn't smaller than the window
+        // ----------------------------------------------------------------------------------------------------------
+        frameGraph.Reset();
+        rg::RenderGraph::Resource windowTarget = frameGraph.ImportWindow(sceneTargets.WindowWidth(), sceneTargets.WindowHeight());
+        rg::RenderGraph::Resource sceneColor = frameGraph.ImportTexture("scene", sceneTargets.ColorBuffer(), sceneTargets.Framebuffer(),
+                                                                        sceneTargets.Width(), sceneTargets.Height());
+        rg::RenderGraph::Resource bloomColor = frameGraph.ImportExternal("bloom");
+        rg::RenderGraph::Resource adaptation = frameGraph.ImportExternal("exposure");
+
+        // 1. the queued draws into the floating point framebuffer
+        frameGraph.AddPass("scene", {}, {sceneColor}, [&] {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            // opaque front-to-back grouped by program and textures, then the skybox, then vegetation back-to-front
+            renderQueue.Flush();
+            // stream in the mip levels this frame's models asked for, evicting unused ones to stay in budget
+            residency.Update();
+        });
+
+        // 2. blur bright fragments, through the mip chain or with the Gaussian ping-pong
+        frameGraph.AddPass("bloom", {sceneColor}, {bloomColor}, [&, sceneColor, bloomColor] {
+            frameGraph.SetTexture(bloomColor, bloomPass.Render(frameGraph.Texture(sceneColor)));
+        });
+
+        // 3. measure the scene's brightness and move the exposure towards it; stays on the GPU, the composite
+        // fetches the result
+        frameGraph.AddPass("exposure", {sceneColor}, {adaptation}, [&, sceneColor, adaptation] {
+            const rg::TextureDesc &scene = frameGraph.Desc(sceneColor);
+            frameGraph.SetTexture(adaptation, autoExposure.Update(frameGraph.Texture(sceneColor), scene.width,
+                                                                  scene.height, deltaTime));
+        });
+
+        // 4. now render floating point color buffer to 2D quad and tonemap HDR colors to default framebuffer's (clamped) color range,
+        // or at the scene's resolution for the upscaler when that is below the window's
+        std::vector<rg::RenderGraph::Resource> compositeReads = {sceneColor};
+        if (bloom)
+            compositeReads.push_back(bloomColor);
+        if (programState->autoExposure)
+            compositeReads.push_back(adaptation);
+        rg::RenderGraph::Resource composited = windowTarget;
+        if (upscale)
+            composited = frameGraph.CreateTexture("composite", rg::TextureDesc{sceneTargets.Width(), sceneTargets.Height(),
+                                                                               rg::Upscaler::FORMAT});
+        frameGraph.AddPass("composite", compositeReads, {composited}, [&, sceneColor, bloomColor, adaptation] {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            bloomShader.use();
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, frameGraph.Texture(sceneColor));
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, bloom ? frameGraph.Texture(bloomColor) : 0);
+            glActiveTexture(GL_TEXTURE2);
+            glBindTexture(GL_TEXTURE_2D, programState->autoExposure ? frameGraph.Texture(adaptation) : 0);
+            glActiveTexture(GL_TEXTURE3);
+            glBindTexture(GL_TEXTURE_3D, colorLut.Texture());
+            bloomShader.setInt("bloom", bloom);
+            bloomShader.setFloat("bloomStrength", bloomPass.Strength());
+            bloomShader.setBool("autoExposure", programState->autoExposure);
+            bloomShader.setFloat("exposure", exposure);
+            // the LUT encodes to sRGB, which the upscaler's passes work on, so this writes with GL_FRAMEBUFFER_SRGB off
             renderQuad();
-            horizontal = !horizontal;
-            if (first_iteration)
-                first_iteration = false;
+        });
+
+        // 5. upscale to the window's resolution, then sharpen
+        if (upscale) {
+            rg::RenderGraph::Resource upscaled = frameGraph.CreateTexture("upscaled",
+                    rg::TextureDesc{sceneTargets.WindowWidth(), sceneTargets.WindowHeight(), rg::Upscaler::FORMAT});
+            frameGraph.AddPass("upsample", {composited}, {upscaled}, [&, composited] {
+                const rg::TextureDesc &input = frameGraph.Desc(composited);
+                upscaler.Upsample(frameGraph.Texture(composited), input.width, input.height,
+                                  sceneTargets.WindowWidth(), sceneTargets.WindowHeight());
+            });
+            frameGraph.AddPass("sharpen", {upscaled}, {windowTarget}, [&, upscaled] {
+                upscaler.Sharpen(frameGraph.Texture(upscaled));
+            });
         }
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-        // 3. now render floating point color buffer to 2D quad and tonemap HDR colors to default framebuffer's (clamped) color range
-        // --------------------------------------------------------------------------------------------------------------------------
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        bloomShader.use();
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, colorBuffers[0]);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, pingpongColorbuffers[!horizontal]);
-        bloomShader.setInt("bloom", bloom);
-        bloomShader.setFloat("exposure", exposure);
-        renderQuad();
 
+        // 6. the UI on top
         if (programState->ImGuiEnabled)
-            DrawImGui(programState);
+            frameGraph.AddPass("imgui", {}, {windowTarget}, [&] {
+                DrawImGui(programState, residency, bloomPass, autoExposure, governor, quality, frameGraph);
+            });
+
+        frameGraph.MarkOutput(windowTarget);
+        frameGraph.Compile();
+        frameGraph.Run();
+        gpuTimer.End();
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
@@ -747,17 +905,17 @@ int main() {
         glfwPollEvents();
     }
 
+    // sceneTargets goes away with main's scope, the callbacks mustn't reach it any more
+    renderTargets = nullptr;
+
     programState->SaveToFile("resources/program_state.txt");
     delete programState;
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
-    // glfw: terminate, clearing all previously allocated GLFW resources.
+    // glfw: terminate, clearing all previously allocated GLFW resources (glfwTerminator,
+    // once the GL objects above have been deleted).
     // ------------------------------------------------------------------
-    glDeleteVertexArrays(1, &skyboxVAO);
-    glDeleteBuffers(1, &skyboxVAO);
-
-    glfwTerminate();
     return 0;
 }
 
@@ -802,9 +960,10 @@ void processInput(GLFWwindow *window) {
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
 // ---------------------------------------------------------------------------------------------
 void framebuffer_size_callback(GLFWwindow *window, int width, int height) {
-    // make sure the viewport matches the new window dimensions; note that width and
-    // height will be significantly larger than specified on retina displays.
-    glViewport(0, 0, width, height);
+    // the render targets follow the new window dimensions, and the composite's viewport with them;
+    // note that width and height will be significantly larger than specified on retina displays.
+    if (renderTargets)
+        renderTargets->SetWindowSize(width, height);
 }
 
 // glfw: whenever the mouse moves, this callback is called
@@ -832,7 +991,9 @@ void scroll_callback(GLFWwindow *window, double xoffset, double yoffset) {
     programState->camera.ProcessMouseScroll(yoffset);
 }
 
-void DrawImGui(ProgramState *programState) {
+void DrawImGui(ProgramState *programState, const rg::TextureResidency &residency, const rg::Bloom &bloomPass,
+               const rg::AutoExposure &autoExposure, const rg::FrameGovernor &governor,
+               const rg::QualitySettings &quality, const rg::RenderGraph &frameGraph) {
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
@@ -861,6 +1022,123 @@ void DrawImGui(ProgramState *programState) {
         ImGui::End();
     }
 
+    {
+        ImGui::Begin("Texture streaming");
+        ImGui::SliderInt("Budget (MB)", &programState->textureBudgetMB, 16, 1024);
+        ImGui::Text("Resident: %.1f / %.1f MB (full chains %.1f MB)", residency.ResidentBytes() / 1048576.0,
+                    residency.Budget() / 1048576.0, residency.FullBytes() / 1048576.0);
+        ImGui::Text("Textures: %zu, streaming: %zu", residency.Tracked(), residency.Streaming());
+        ImGui::End();
+    }
+
+    {
+        ImGui::Begin("Resolution");
+        ImGui::SliderFloat("Render scale", &programState->renderScale, rg::MIN_RENDER_SCALE, rg::MAX_RENDER_SCALE);
+        if (renderTargets)
+            ImGui::Text("Scene %d x %d, window %d x %d", renderTargets->Width(), renderTargets->Height(),
+                        renderTargets->WindowWidth(), renderTargets->WindowHeight());
+        ImGui::Checkbox("Upscaler (FSR 1)", &programState->upscaler);
+        if (programState->upscaler)
+            ImGui::DragFloat("Sharpness (stops)", &programState->sharpness, 0.05, 0.0, 2.0);
+        ImGui::DragFloat("Vegetation distance", &programState->vegetationDistance, 0.5, 1.0, 100.0);
+        ImGui::End();
+    }
+
+    {
+        ImGui::Begin("Render targets");
+        const char *profileNames[] = {"Quality", "Balanced", "Bandwidth"};
+        int profile = static_cast<int>(programState->formatProfile);
+        for (int i = 0; i < 3; ++i) {
+            ImGui::RadioButton(profileNames[i], &profile, i);
+            if (i < 2)
+                ImGui::SameLine();
+        }
+        programState->formatProfile = static_cast<rg::FormatProfile>(profile);
+        ImGui::Text("Estimated bytes moved per frame (scene + bloom):");
+        for (int i = 0; i < 3; ++i) {
+            rg::TargetFormats formats = rg::targetFormats(static_cast<rg::FormatProfile>(i));
+            size_t sceneBytes = 0;
+            if (renderTargets)
+                sceneBytes = rg::RenderTargets::EstimateFrameBytes(formats.color, formats.depth, renderTargets->Width(),
+                                                                   renderTargets->Height());
+            size_t bloomBytes = bloomPass.EstimateFrameBytes(formats.color, formats.halfResolutionBloom);
+            ImGui::Text("%c %-9s %6.1f MB = %.1f + %.1f", i == profile ? '>' : ' ', profileNames[i],
+                        (sceneBytes + bloomBytes) / 1048576.0, sceneBytes / 1048576.0, bloomBytes / 1048576.0);
+        }
+        ImGui::End();
+    }
+
+    {
+        ImGui::Begin("Render graph");
+        for (const rg::RenderGraph::PassInfo &pass : frameGraph.Passes())
+            ImGui::Text("%s%s", pass.name.c_str(), pass.culled ? " (culled)" : "");
+        ImGui::Text("Transients: %d in %d textures, %.1f MB in %.1f MB", frameGraph.TransientCount(),
+                    frameGraph.AllocatedCount(), frameGraph.TransientBytes() / 1048576.0,
+                    frameGraph.AllocatedBytes() / 1048576.0);
+        ImGui::End();
+    }
+
+    {
+        ImGui::Begin("Exposure");
+        ImGui::Checkbox("Auto exposure", &programState->autoExposure);
+        if (programState->autoExposure) {
+            ImGui::DragFloat("Compensation (stops)", &programState->exposureCompensation, 0.05, -4.0, 4.0);
+            ImGui::DragFloat("Adapt to brighter (1/s)", &programState->adaptSpeedUp, 0.05, 0.1, 10.0);
+            ImGui::DragFloat("Adapt to darker (1/s)", &programState->adaptSpeedDown, 0.05, 0.1, 10.0);
+            if (autoExposure.ComputeHistogramAvailable())
+                ImGui::Checkbox("Compute shader histogram", &programState->computeHistogram);
+            else
+                ImGui::Text("Compute shaders unavailable, averaging a mip chain");
+        } else {
+            ImGui::DragFloat("Exposure", &exposure, 0.01, 0.01, 10.0);
+        }
+        ImGui::End();
+    }
+
+    {
+        ImGui::Begin("Color grading");
+        ImGui::ColorEdit3("Filter", programState->grading.filter);
+        ImGui::DragFloat("Contrast", &programState->grading.contrast, 0.01, 0.5, 2.0);
+        ImGui::DragFloat("Saturation", &programState->grading.saturation, 0.01, 0.0, 2.0);
+        ImGui::End();
+    }
+
+    {
+        ImGui::Begin("Frame time");
+        ImGui::Checkbox("Governor", &programState->governor);
+        ImGui::DragFloat("Target (ms)", &programState->frameTimeTarget, 0.1, 4.0, 50.0);
+        ImGui::Text("GPU: %.2f ms", governor.AverageTime());
+        ImGui::Text("Step: %d / %d", governor.CurrentStep(), rg::FrameGovernor::STEP_COUNT - 1);
+        ImGui::Text("Render scale: %.2f", quality.renderScale);
+        ImGui::Text("Bloom levels: %d, blur passes: %d", quality.bloomLevels, quality.blurPasses);
+        ImGui::Text("Vegetation distance: %.1f", quality.vegetationDistance);
+        ImGui::Text("Texture mip bias: %.1f", quality.mipBias);
+        ImGui::End();
+    }
+
+    {
+        ImGui::Begin("Bloom");
+        int mode = static_cast<int>(programState->bloomMode);
+        ImGui::RadioButton("Mip chain", &mode, static_cast<int>(rg::BloomMode::MipChain));
+        ImGui::SameLine();
+        ImGui::RadioButton("Gaussian", &mode, static_cast<int>(rg::BloomMode::Gaussian));
+        programState->bloomMode = static_cast<rg::BloomMode>(mode);
+        ImGui::DragFloat("Threshold", &programState->bloomThreshold, 0.05, 0.0, 10.0);
+        ImGui::DragFloat("Knee", &programState->bloomKnee, 0.05, 0.0, 5.0);
+        if (programState->bloomMode == rg::BloomMode::MipChain) {
+            ImGui::SliderInt("Levels", &programState->bloomLevels, 1, rg::Bloom::MAX_LEVELS);
+            ImGui::DragFloat("Radius", &programState->bloomRadius, 0.05, 0.5, 4.0);
+        } else {
+            ImGui::SliderInt("Blur radius", &programState->blurRadius, 1, rg::Bloom::MAX_BLUR_RADIUS);
+            ImGui::SliderInt("Blur passes", &programState->blurPasses, 2, 20);
+            if (bloomPass.ComputeBlurAvailable())
+                ImGui::Checkbox("Compute shader blur", &programState->computeBlur);
+            else
+                ImGui::Text("Compute shaders unavailable, blurring in fragment shaders");
+        }
+        ImGui::End();
+    }
+
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
@@ -877,78 +1155,103 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
     }
 }
 
-unsigned int loadCubemap(vector<std::string> faces)
+// 1x1 texture shown until the real image has been loaded: transparent black for 2D textures, black cube map faces
+unsigned int createPlaceholderTexture(GLenum target)
 {
     unsigned int textureID;
     glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+    glBindTexture(target, textureID);
 
-    int width, height, nrChannels;
-    for (unsigned int i = 0; i < faces.size(); i++)
+    const unsigned char pixel[4] = {0, 0, 0, 0};
+    if (target == GL_TEXTURE_CUBE_MAP)
     {
-        unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-        if (data)
-        {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-            stbi_image_free(data);
-        }
-        else
-        {
-            std::cout << "Cubemap texture failed to load at path: " << faces[i] << std::endl;
-            stbi_image_free(data);
-        }
+        for (unsigned int i = 0; i < 6; i++)
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
     }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    else
+    {
+        glTexImage2D(target, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+    }
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
     return textureID;
 }
 
-unsigned int loadTexture(char const * path)
+void uploadCubemap(rg::UploadScheduler& uploads, rg::CachedTexture& cubemap, const vector<rg::TextureSource>& faces, const vector<std::string>& paths)
 {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
-    if (data)
+    // the cube map is cached as a whole, under the combined keys of its faces
+    uint64_t key = 0;
+    for (unsigned int i = 0; i < faces.size(); i++)
     {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT); // for this tutorial: use GL_CLAMP_TO_EDGE to prevent semi-transparent borders. Due to interpolation it takes texels from next repeat
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
+        if (!faces[i])
+        {
+            std::cout << "Cubemap texture failed to load at path: " << paths[i] << std::endl;
+            for (const rg::TextureSource& face : faces)
+                rg::TextureCache::Instance().Forget(face);
+            return;
+        }
+        key = rg::TextureCache::combineKeys(key, faces[i].key);
     }
-    else
+
+    // the faces stream into a new texture that replaces the placeholder once all six have arrived
+    std::shared_ptr<rg::CachedTexture> streamed = std::make_shared<rg::CachedTexture>(
+            rg::TextureCache::Instance().Acquire(key, [&uploads, &faces]() -> GLuint {
+                unsigned int textureID;
+                glGenTextures(1, &textureID);
+                for (unsigned int i = 0; i < faces.size(); i++)
+                {
+                    std::shared_ptr<const rg::Image> image = faces[i].image;
+                    if (!image)
+                        image = std::make_shared<const rg::Image>(rg::loadImage(faces[i].path));
+                    uploads.UploadImage(textureID, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, std::move(image), false, true);
+                }
+                glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+                glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+                glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+                glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+                return textureID;
+            }));
+    // the faces are in the upload queue now; Load shouldn't hand their decoded images out any more
+    for (const rg::TextureSource& face : faces)
+        rg::TextureCache::Instance().Forget(face);
+    uploads.Then([&cubemap, streamed] { cubemap = std::move(*streamed); });
+}
+
+void uploadTexture(rg::UploadScheduler& uploads, rg::CachedTexture& texture, const rg::TextureSource& source, const std::string& path)
+{
+    // streams into a new texture that replaces the placeholder once it is complete
+    std::shared_ptr<rg::CachedTexture> streamed = std::make_shared<rg::CachedTexture>(
+            rg::TextureCache::Instance().Acquire(source, [&uploads](const std::shared_ptr<const rg::Image>& image) -> GLuint {
+                bool hasAlpha = image->channels == 4;
+
+                unsigned int textureID;
+                glGenTextures(1, &textureID);
+                uploads.UploadImage(textureID, GL_TEXTURE_2D, GL_TEXTURE_2D, image, true, true);
+
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, hasAlpha ? GL_CLAMP_TO_EDGE : GL_REPEAT); // for this tutorial: use GL_CLAMP_TO_EDGE to prevent semi-transparent borders. Due to interpolation it takes texels from next repeat
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, hasAlpha ? GL_CLAMP_TO_EDGE : GL_REPEAT);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+                return textureID;
+            }));
+    if (!*streamed)
     {
         std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
+        return;
     }
-
-    return textureID;
+    uploads.Then([&texture, streamed] { texture = std::move(*streamed); });
 }
 
-// renderCube() renders a 1x1 3D cube in NDC.
-// -------------------------------------------------
+// getCubeVAO() returns the vertex array of a 1x1 3D cube in NDC, 36 vertices, created on first use.
+// ------------------------------------------------------------------------------------------------
 unsigned int cubeVAO = 0;
 unsigned int cubeVBO = 0;
-void renderCube()
+unsigned int getCubeVAO()
 {
     // initialize (if necessary)
     if (cubeVAO == 0)
@@ -1013,10 +1316,7 @@ void renderCube()
         glBindBuffer(GL_ARRAY_BUFFER, 0);
         glBindVertexArray(0);
     }
-    // render Cube
-    glBindVertexArray(cubeVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-    glBindVertexArray(0);
+    return cubeVAO;
 }
 
 // renderQuad() renders a 1x1 XY quad in NDC
@@ -0,0 +1,401 @@
+// Cooks the source assets into what the game loads without further work, written next to each source:
+//
+//   *.obj (and its .mtl)   -> .rgmesh  triangulated, smooth normals and tangents, identical vertices joined,
+//                                      reordered for the vertex cache (rg/BakedModel.h)
+//   JPG/PNG/TGA/BMP images -> .dds     block compressed with the full mip chain (rg/BlockCompression.h)
+//                                      color maps' mips filtered in linear light, like glGenerateMipmap
+//
+//   asset_cooker [--force] [file or directory ...]
+//
+// Directories are searched recursively; without arguments the whole resources directory is cooked.
+// cooked.manifest in the project root remembers, for every output (by canonical path), a hash of the cooker version and of
+// the contents of everything it was made from (a model's .obj and .mtl files). An asset is only cooked
+// again when that hash changes or its output is missing, or with --force. The work runs on all cores.
+
+#include <stb_image.h>
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include <learnopengl/filesystem.h>
+#include <rg/BakedModel.h>
+#include <rg/BlockCompression.h>
+#include <rg/DDS.h>
+#include <rg/Hash.h>
+#include <rg/ThreadPool.h>
+#include <rg/VirtualFileSystem.h>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// bump whenever the cooked output changes for the same input, so that everything is cooked again
+static const uint64_t COOKER_VERSION = 3;
+
+enum class AssetKind {
+    Model,
+    Texture
+};
+
+struct CookJob {
+    AssetKind kind;
+    std::string source;
+    std::string output;
+    uint64_t key = 0; // cooker version and dependency contents
+};
+
+static std::string lowercaseExtension(const std::string& path) {
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return "";
+    }
+    std::string extension = path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    return extension;
+}
+
+static void collect(const std::string& path, std::vector<CookJob>& jobs) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) {
+        std::cout << "No such file or directory: " << path << std::endl;
+        return;
+    }
+    if (!S_ISDIR(info.st_mode)) {
+        std::string extension = lowercaseExtension(path);
+        // canonical, so the same file reached through different paths has one manifest entry
+        std::string source = rg::canonicalPath(path);
+        if (extension == "obj") {
+            jobs.push_back(CookJob{AssetKind::Model, source, rg::bakedModelPath(source)});
+        } else if (extension == "jpg" || extension == "jpeg" || extension == "png" || extension == "tga" ||
+                   extension == "bmp") {
+            jobs.push_back(CookJob{AssetKind::Texture, source, rg::compressedPath(source)});
+        }
+        return;
+    }
+    DIR* directory = opendir(path.c_str());
+    if (!directory) {
+        return;
+    }
+    while (dirent* entry = readdir(directory)) {
+        if (std::strcmp(entry->d_name, ".") != 0 && std::strcmp(entry->d_name, "..") != 0) {
+            collect(path + '/' + entry->d_name, jobs);
+        }
+    }
+    closedir(directory);
+}
+
+static bool readFile(const std::string& path, std::vector<unsigned char>& bytes) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return true;
+}
+
+static uint64_t hashFile(const std::string& path) {
+    std::vector<unsigned char> bytes;
+    return readFile(path, bytes) ? rg::hashBytes(bytes.data(), bytes.size()) : 0;
+}
+
+// the material libraries in the directory of path
+static std::vector<std::string> siblingMaterialLibraries(const std::string& path) {
+    std::string directory = path.substr(0, path.find_last_of('/'));
+    std::vector<std::string> libraries;
+    if (DIR* entries = opendir(directory.c_str())) {
+        while (dirent* entry = readdir(entries)) {
+            std::string name = directory + '/' + entry->d_name;
+            if (lowercaseExtension(name) == "mtl") {
+                libraries.push_back(name);
+            }
+        }
+        closedir(entries);
+    }
+    std::sort(libraries.begin(), libraries.end());
+    return libraries;
+}
+
+// Whether the image at path is a color map, sampled as sRGB, so its mips are filtered in linear light.
+// Data maps (specular, bump, ...) aren't: an image the material libraries next to it only name for other
+// maps than map_Kd. Everything else, the skybox and the sprites too, is color.
+static bool isColorMap(const std::string& path) {
+    std::string name = path.substr(path.find_last_of('/') + 1);
+    bool data = false;
+    for (const std::string& library : siblingMaterialLibraries(path)) {
+        std::ifstream in(library);
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream words(line);
+            std::string keyword, word, file;
+            if (!(words >> keyword)) {
+                continue;
+            }
+            // the file name is the last word, after any options
+            while (words >> word) {
+                file = word;
+            }
+            if (file.substr(file.find_last_of("/\\") + 1) != name) {
+                continue;
+            }
+            if (keyword == "map_Kd") {
+                return true;
+            }
+            data = data || keyword.compare(0, 4, "map_") == 0 || keyword == "bump" || keyword == "disp";
+        }
+    }
+    return !data;
+}
+
+// the hash a baked model keeps of its source, see rg::modelSourceHash
+static uint64_t modelSourceHash(const std::string& path, const std::vector<unsigned char>& obj) {
+    return rg::modelSourceHash(path, obj.data(), obj.size(), hashFile);
+}
+
+// hash of everything the output depends on; a missing dependency counts as a distinct value, so that
+// creating it later cooks the asset again
+static uint64_t dependencyKey(const CookJob& job) {
+    uint64_t key = rg::combineHashes(COOKER_VERSION, static_cast<uint64_t>(job.kind));
+    std::vector<unsigned char> bytes;
+    if (!readFile(job.source, bytes)) {
+        return 0;
+    }
+    if (job.kind == AssetKind::Model) {
+        key = rg::combineHashes(key, rg::meshfile::VERSION);
+        return rg::combineHashes(key, modelSourceHash(job.source, bytes));
+    }
+    key = rg::combineHashes(key, rg::hashBytes(bytes.data(), bytes.size()));
+    // the neighbouring materials decide whether it is a color map
+    for (const std::string& library : siblingMaterialLibraries(job.source)) {
+        key = rg::combineHashes(key, hashFile(library));
+    }
+    return key;
+}
+
+static std::string manifestPath() {
+    return FileSystem::getPath("cooked.manifest");
+}
+
+// output path -> key it was cooked with; one "<key in hex> <output>" per line
+static std::map<std::string, uint64_t> readManifest() {
+    std::map<std::string, uint64_t> manifest;
+    std::ifstream in(manifestPath());
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t space = line.find(' ');
+        if (space != std::string::npos) {
+            manifest[line.substr(space + 1)] = std::strtoull(line.substr(0, space).c_str(), nullptr, 16);
+        }
+    }
+    return manifest;
+}
+
+// written to a temporary file first, so an interrupted run never leaves a truncated manifest behind
+static bool writeManifest(const std::map<std::string, uint64_t>& manifest) {
+    std::string temporary = manifestPath() + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::trunc);
+        for (const auto& entry : manifest) {
+            char key[17];
+            std::snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(entry.second));
+            out << key << ' ' << entry.first << '\n';
+        }
+        if (!out) {
+            return false;
+        }
+    }
+    return std::rename(temporary.c_str(), manifestPath().c_str()) == 0;
+}
+
+static void collectMeshes(const aiNode* node, const aiScene* scene, std::vector<const aiMesh*>& meshes) {
+    for (unsigned int i = 0; i < node->mNumMeshes; ++i) {
+        meshes.push_back(scene->mMeshes[node->mMeshes[i]]);
+    }
+    for (unsigned int i = 0; i < node->mNumChildren; ++i) {
+        collectMeshes(node->mChildren[i], scene, meshes);
+    }
+}
+
+static bool cookModel(const CookJob& job, std::string& summary) {
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(job.source, aiProcess_Triangulate | aiProcess_GenSmoothNormals |
+                                                         aiProcess_FlipUVs | aiProcess_CalcTangentSpace |
+                                                         aiProcess_JoinIdenticalVertices |
+                                                         aiProcess_ImproveCacheLocality | aiProcess_OptimizeMeshes);
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+        summary = importer.GetErrorString();
+        return false;
+    }
+    std::vector<const aiMesh*> sceneMeshes;
+    collectMeshes(scene->mRootNode, scene, sceneMeshes);
+
+    // the same material maps Model::processMesh picks, typed like TextureType
+    const aiTextureType materialTypes[] = {aiTextureType_DIFFUSE, aiTextureType_SPECULAR, aiTextureType_HEIGHT,
+                                           aiTextureType_AMBIENT};
+    std::vector<std::vector<float>> vertices(sceneMeshes.size());
+    std::vector<std::vector<uint32_t>> indices(sceneMeshes.size());
+    std::vector<unsigned char> source;
+    if (!readFile(job.source, source)) {
+        summary = "can't read " + job.source;
+        return false;
+    }
+    rg::BakedModel model;
+    model.tangents = true;
+    model.sourceHash = modelSourceHash(job.source, source);
+    model.meshes.resize(sceneMeshes.size());
+    size_t vertexCount = 0, triangleCount = 0;
+    for (size_t m = 0; m < sceneMeshes.size(); ++m) {
+        const aiMesh* mesh = sceneMeshes[m];
+        std::vector<float>& out = vertices[m];
+        out.reserve(mesh->mNumVertices * rg::BAKED_VERTEX_SIZE / sizeof(float));
+        for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
+            aiVector3D zero(0.0f, 0.0f, 0.0f);
+            const aiVector3D& normal = mesh->HasNormals() ? mesh->mNormals[i] : zero;
+            const aiVector3D& uv = mesh->mTextureCoords[0] ? mesh->mTextureCoords[0][i] : zero;
+            const aiVector3D& tangent = mesh->HasTangentsAndBitangents() ? mesh->mTangents[i] : zero;
+            const aiVector3D& bitangent = mesh->HasTangentsAndBitangents() ? mesh->mBitangents[i] : zero;
+            const float vertex[] = {mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z,
+                                    normal.x, normal.y, normal.z,
+                                    uv.x, uv.y,
+                                    tangent.x, tangent.y, tangent.z,
+                                    bitangent.x, bitangent.y, bitangent.z};
+            out.insert(out.end(), std::begin(vertex), std::end(vertex));
+        }
+        for (unsigned int i = 0; i < mesh->mNumFaces; ++i) {
+            const aiFace& face = mesh->mFaces[i];
+            indices[m].insert(indices[m].end(), face.mIndices, face.mIndices + face.mNumIndices);
+        }
+
+        rg::BakedMesh& baked = model.meshes[m];
+        baked.vertexCount = mesh->mNumVertices;
+        baked.indexCount = static_cast<uint32_t>(indices[m].size());
+        baked.vertices = reinterpret_cast<const unsigned char*>(out.data());
+        baked.indices = reinterpret_cast<const unsigned char*>(indices[m].data());
+        const aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+        for (uint8_t type = 0; type < 4; ++type) {
+            for (unsigned int i = 0; i < material->GetTextureCount(materialTypes[type]); ++i) {
+                aiString path;
+                material->GetTexture(materialTypes[type], i, &path);
+                baked.textures.push_back(rg::BakedTexture{type, path.C_Str()});
+            }
+        }
+        vertexCount += mesh->mNumVertices;
+        triangleCount += mesh->mNumFaces;
+    }
+    if (!rg::writeBakedModel(job.output, model)) {
+        summary = "can't write " + job.output;
+        return false;
+    }
+    summary = std::to_string(model.meshes.size()) + " meshes, " + std::to_string(vertexCount) + " vertices, " +
+              std::to_string(triangleCount) + " triangles";
+    return true;
+}
+
+static const char* formatName(rg::BlockFormat format) {
+    switch (format) {
+        case rg::BlockFormat::BC1: return "BC1";
+        case rg::BlockFormat::BC3: return "BC3";
+        case rg::BlockFormat::BC4: return "BC4";
+        case rg::BlockFormat::BC5: return "BC5";
+        case rg::BlockFormat::BC7: return "BC7";
+    }
+    return "?";
+}
+
+static bool cookTexture(const CookJob& job, std::string& summary) {
+    int width, height, channels;
+    unsigned char* rgba = stbi_load(job.source.c_str(), &width, &height, &channels, 4);
+    if (!rgba) {
+        summary = stbi_failure_reason();
+        return false;
+    }
+    rg::BlockFormat format = rg::chooseBlockFormat(rgba, width, height, channels);
+    bool srgb = channels >= 3 && isColorMap(job.source);
+    rg::CompressedImage image = rg::compressImage(rgba, width, height, format, srgb);
+    stbi_image_free(rgba);
+    // recorded in the header so the loader can tell when the source has changed since
+    image.sourceHash = hashFile(job.source);
+    if (!rg::writeDDS(job.output, image)) {
+        summary = "can't write " + job.output;
+        return false;
+    }
+    summary = std::string(formatName(format)) + ", " + std::to_string(width) + 'x' + std::to_string(height) + ", " +
+              std::to_string(image.levels.size()) + " levels, " + std::to_string(image.data.size() / 1024) + " KiB";
+    return true;
+}
+
+static bool exists(const std::string& path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0;
+}
+
+int main(int argc, char** argv) {
+    bool force = false;
+    std::vector<CookJob> jobs;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--force") == 0) {
+            force = true;
+        } else {
+            collect(argv[i], jobs);
+        }
+    }
+    if (argc == 1 || (argc == 2 && force)) {
+        collect(FileSystem::getPath("resources"), jobs);
+    }
+    // a file named twice is cooked once
+    std::sort(jobs.begin(), jobs.end(), [](const CookJob& a, const CookJob& b) { return a.output < b.output; });
+    jobs.erase(std::unique(jobs.begin(), jobs.end(), [](const CookJob& a, const CookJob& b) { return a.output == b.output; }),
+               jobs.end());
+
+    std::map<std::string, uint64_t> manifest = readManifest();
+    std::mutex mutex; // guards the manifest and the output
+    std::atomic<int> cooked{0};
+    std::atomic<int> failures{0};
+    rg::ThreadPool workers;
+    workers.ParallelFor(jobs.size(), [&](size_t i) {
+        CookJob& job = jobs[i];
+        job.key = dependencyKey(job);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto known = manifest.find(job.output);
+            if (!force && job.key != 0 && known != manifest.end() && known->second == job.key && exists(job.output)) {
+                return;
+            }
+        }
+
+        std::string summary;
+        bool done = job.key != 0 && (job.kind == AssetKind::Model ? cookModel(job, summary) : cookTexture(job, summary));
+        std::lock_guard<std::mutex> lock(mutex);
+        if (done) {
+            manifest[job.output] = job.key;
+            ++cooked;
+            std::cout << job.source << " -> " << job.output << " (" << summary << ")" << std::endl;
+        } else {
+            manifest.erase(job.output);
+            ++failures;
+            std::cout << "Failed to cook " << job.source << (summary.empty() ? "" : ": " + summary) << std::endl;
+        }
+    });
+
+    if (!writeManifest(manifest)) {
+        std::cout << "Failed to write " << manifestPath() << std::endl;
+        return 1;
+    }
+    std::cout << cooked << " cooked, " << jobs.size() - cooked - failures << " up to date, " << failures << " failed"
+              << std::endl;
+    return failures == 0 ? 0 : 1;
+}
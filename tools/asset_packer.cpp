@@ -0,0 +1,117 @@
+// Packs the resources directory into a single indexed file, resources.pack in the project root. When
+// the game finds it at startup every shader, model and texture is served from the memory-mapped pack
+// (rg/VirtualFileSystem.h) instead of being opened file by file.
+//
+//   asset_packer [--lz4] [--output file] [directory or file ...]
+//
+// Paths are relative to the project root and become the entry names, so the pack has to sit in the
+// root to be found. Without paths the whole resources directory is packed. With --lz4 each entry is
+// compressed if that makes it noticeably smaller; JPEGs and PNGs are stored as they are anyway.
+// Run asset_cooker first so that the cooked .rgmesh and .dds files end up in the pack too.
+
+#include <learnopengl/filesystem.h>
+#include <rg/AssetPack.h>
+#include <rg/ThreadPool.h>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+static void collect(const std::string& name, std::vector<std::string>& names) {
+    std::string path = FileSystem::getPath(name);
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) {
+        std::cout << "No such file or directory: " << path << std::endl;
+        return;
+    }
+    if (!S_ISDIR(info.st_mode)) {
+        names.push_back(name);
+        return;
+    }
+    DIR* directory = opendir(path.c_str());
+    if (!directory) {
+        return;
+    }
+    while (dirent* entry = readdir(directory)) {
+        if (std::strcmp(entry->d_name, ".") != 0 && std::strcmp(entry->d_name, "..") != 0) {
+            collect(name + '/' + entry->d_name, names);
+        }
+    }
+    closedir(directory);
+}
+
+struct PackedFile {
+    std::vector<unsigned char> bytes;
+    std::vector<unsigned char> compressed;
+    bool read = false;
+};
+
+int main(int argc, char** argv) {
+    bool compress = false;
+    std::string output = FileSystem::getPath("resources.pack");
+    std::vector<std::string> names;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--lz4") == 0) {
+            compress = true;
+        } else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else {
+            collect(rg::normalizePath(argv[i]), names);
+        }
+    }
+    if (names.empty()) {
+        collect("resources", names);
+    }
+    // sorted, so that the same inputs always give the same pack
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+
+    // reading and compressing run in parallel, writing in order
+    std::vector<PackedFile> files(names.size());
+    rg::ThreadPool workers;
+    workers.ParallelFor(files.size(), [&](size_t i) {
+        std::ifstream in(FileSystem::getPath(names[i]), std::ios::binary);
+        if (!in) {
+            return;
+        }
+        PackedFile& file = files[i];
+        file.bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        file.read = true;
+        if (compress) {
+            file.compressed = rg::AssetPackWriter::Compress(file.bytes.data(), file.bytes.size());
+        }
+    });
+
+    rg::AssetPackWriter writer(output);
+    if (!writer) {
+        std::cout << "Failed to create " << output << std::endl;
+        return 1;
+    }
+    int failures = 0;
+    for (size_t i = 0; i < files.size(); ++i) {
+        const PackedFile& file = files[i];
+        if (!file.read) {
+            std::cout << "Failed to read " << names[i] << std::endl;
+            ++failures;
+        } else if (!file.compressed.empty()) {
+            writer.AddStored(names[i], file.compressed.data(), file.compressed.size(), file.bytes.size(), true);
+        } else {
+            writer.AddStored(names[i], file.bytes.data(), file.bytes.size(), file.bytes.size(), false);
+        }
+    }
+    if (!writer.Finish()) {
+        std::cout << "Failed to write " << output << std::endl;
+        return 1;
+    }
+    std::cout << output << ": " << files.size() - failures << " files, " << writer.Bytes() / 1024 << " KiB in "
+              << writer.StoredBytes() / 1024 << " KiB" << std::endl;
+    return failures == 0 ? 0 : 1;
+}